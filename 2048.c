@@ -4,21 +4,31 @@
 #include <unistd.h>
 #include <time.h>
 #include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "term_output.h"
+#include "frame_stats.h"
 
 #ifdef _WIN32
     #include <conio.h>
     #include <windows.h>
-    #define CLEAR_CMD "cls"
 #else
     #include <termios.h>
     #include <fcntl.h>
-    #define CLEAR_CMD "clear"
 #endif
 
 #define TICK_RATE 10
 #define MICROSECONDS_PER_TICK (1000000 / TICK_RATE)
 #define BOARD_WIDTH 4
 #define BOARD_HEIGHT 4
+#define ANALYSIS_DEPTH 3
+#define ANALYSIS_MIN_PROBABILITY 0.0001
+#define BLUNDER_THRESHOLD 0.10
+#define MAX_BLUNDERS 1024
+#define REPORT_FILE "2048_report.txt"
+#define SNAPSHOT_FRESH 4
+#define CLEAR_SCREEN "\033[H\033[2J"
 
 typedef enum {
     DIR_NONE, DIR_UP, DIR_DOWN, DIR_LEFT, DIR_RIGHT
@@ -29,6 +39,45 @@ static Direction current_direction = DIR_NONE;
 static int score = 0;
 static bool game_over = false;
 static bool won = false;
+static TermOutput out;
+static FrameStats stats;
+static bool stats_visible = false;
+
+typedef struct {
+    int board[BOARD_HEIGHT][BOARD_WIDTH];
+    Direction played;
+    unsigned int move_number;
+    unsigned int game_number;
+} MoveSnapshot;
+
+typedef struct {
+    unsigned int game_number;
+    unsigned int move_number;
+    Direction played;
+    Direction best;
+    double loss;
+} Blunder;
+
+static const char *direction_names[] = {"-", "Up", "Down", "Left", "Right"};
+
+// Triple buffer: process_input owns snapshot_back, the analyzer owns
+// snapshot_front, and snapshot_middle is swapped atomically between them.
+static MoveSnapshot snapshots[3];
+static int snapshot_back = 0;
+static int snapshot_front = 2;
+static atomic_int snapshot_middle = 1;
+static atomic_uint latest_move = 0;
+static atomic_bool analyzer_running = false;
+static _Atomic uint64_t analysis_result = 0;
+static pthread_t analyzer_thread;
+static unsigned int move_number = 0;
+static unsigned int game_number = 1;
+
+static unsigned int analysis_job = 0;
+static bool analysis_cancelled = false;
+static Blunder blunders[MAX_BLUNDERS];
+static int blunder_count = 0;
+static int analyzed_moves = 0;
 
 #ifndef _WIN32
 static struct termios original_termios;
@@ -266,6 +315,238 @@ static bool move_down() {
     return moved;
 }
 
+static int *line_cell(int b[BOARD_HEIGHT][BOARD_WIDTH], Direction dir, int line, int i) {
+    switch (dir) {
+        case DIR_LEFT: return &b[line][i];
+        case DIR_RIGHT: return &b[line][BOARD_WIDTH - 1 - i];
+        case DIR_UP: return &b[i][line];
+        default: return &b[BOARD_HEIGHT - 1 - i][line];
+    }
+}
+
+static bool engine_move(int b[BOARD_HEIGHT][BOARD_WIDTH], Direction dir) {
+    bool horizontal = (dir == DIR_LEFT || dir == DIR_RIGHT);
+    int lines = horizontal ? BOARD_HEIGHT : BOARD_WIDTH;
+    int length = horizontal ? BOARD_WIDTH : BOARD_HEIGHT;
+    bool moved = false;
+
+    for (int line = 0; line < lines; line++) {
+        int out[BOARD_WIDTH > BOARD_HEIGHT ? BOARD_WIDTH : BOARD_HEIGHT] = {0};
+        int write_pos = 0;
+        bool can_merge = false;
+
+        for (int i = 0; i < length; i++) {
+            int value = *line_cell(b, dir, line, i);
+            if (value == 0) continue;
+            if (can_merge && out[write_pos - 1] == value) {
+                out[write_pos - 1] *= 2;
+                can_merge = false;
+            } else {
+                out[write_pos++] = value;
+                can_merge = true;
+            }
+        }
+
+        for (int i = 0; i < length; i++) {
+            int *cell = line_cell(b, dir, line, i);
+            if (*cell != out[i]) {
+                *cell = out[i];
+                moved = true;
+            }
+        }
+    }
+    return moved;
+}
+
+static int tile_rank(int value) {
+    int rank = 0;
+    while (value > 1) {
+        value >>= 1;
+        rank++;
+    }
+    return rank;
+}
+
+static double evaluate_board(int b[BOARD_HEIGHT][BOARD_WIDTH]) {
+    int empty = 0;
+    int merges = 0;
+    double sum = 0;
+    double mono_penalty = 0;
+
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        for (int x = 0; x < BOARD_WIDTH; x++) {
+            if (b[y][x] == 0) {
+                empty++;
+                continue;
+            }
+            sum += b[y][x];
+            if (x < BOARD_WIDTH - 1 && b[y][x + 1] == b[y][x]) merges++;
+            if (y < BOARD_HEIGHT - 1 && b[y + 1][x] == b[y][x]) merges++;
+        }
+    }
+
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        double inc = 0, dec = 0;
+        for (int x = 0; x < BOARD_WIDTH - 1; x++) {
+            int diff = tile_rank(b[y][x]) - tile_rank(b[y][x + 1]);
+            if (diff > 0) dec += diff; else inc -= diff;
+        }
+        mono_penalty += (inc < dec) ? inc : dec;
+    }
+    for (int x = 0; x < BOARD_WIDTH; x++) {
+        double inc = 0, dec = 0;
+        for (int y = 0; y < BOARD_HEIGHT - 1; y++) {
+            int diff = tile_rank(b[y][x]) - tile_rank(b[y + 1][x]);
+            if (diff > 0) dec += diff; else inc -= diff;
+        }
+        mono_penalty += (inc < dec) ? inc : dec;
+    }
+
+    double value = 1000 + sum + 270.0 * empty + 700.0 * merges - 47.0 * mono_penalty;
+    return value > 1 ? value : 1;
+}
+
+static double expect_chance(int b[BOARD_HEIGHT][BOARD_WIDTH], int depth, double probability);
+
+static double expect_move(int b[BOARD_HEIGHT][BOARD_WIDTH], int depth, double probability) {
+    if (atomic_load_explicit(&latest_move, memory_order_relaxed) != analysis_job) {
+        analysis_cancelled = true;
+    }
+    if (analysis_cancelled) return 0;
+    if (depth == 0) return evaluate_board(b);
+
+    double best = 0;
+    for (Direction dir = DIR_UP; dir <= DIR_RIGHT; dir++) {
+        int next[BOARD_HEIGHT][BOARD_WIDTH];
+        memcpy(next, b, sizeof(next));
+        if (!engine_move(next, dir)) continue;
+
+        double value = expect_chance(next, depth, probability);
+        if (value > best) best = value;
+    }
+    return best;
+}
+
+static double expect_chance(int b[BOARD_HEIGHT][BOARD_WIDTH], int depth, double probability) {
+    int empty = 0;
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        for (int x = 0; x < BOARD_WIDTH; x++) {
+            if (b[y][x] == 0) empty++;
+        }
+    }
+    if (empty == 0 || probability < ANALYSIS_MIN_PROBABILITY) {
+        return evaluate_board(b);
+    }
+
+    double total = 0;
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        for (int x = 0; x < BOARD_WIDTH; x++) {
+            if (b[y][x] != 0) continue;
+
+            b[y][x] = 2;
+            total += 0.9 * expect_move(b, depth - 1, probability * 0.9 / empty);
+            b[y][x] = 4;
+            total += 0.1 * expect_move(b, depth - 1, probability * 0.1 / empty);
+            b[y][x] = 0;
+
+            if (analysis_cancelled) return 0;
+        }
+    }
+    return total / empty;
+}
+
+static void record_blunder(MoveSnapshot *snap, Direction best, double loss) {
+    if (blunder_count >= MAX_BLUNDERS) return;
+    blunders[blunder_count].game_number = snap->game_number;
+    blunders[blunder_count].move_number = snap->move_number;
+    blunders[blunder_count].played = snap->played;
+    blunders[blunder_count].best = best;
+    blunders[blunder_count].loss = loss;
+    blunder_count++;
+}
+
+static void analyze_snapshot(MoveSnapshot *snap) {
+    double values[DIR_RIGHT + 1] = {0};
+    Direction best = DIR_NONE;
+
+    analysis_job = snap->move_number;
+    analysis_cancelled = false;
+
+    for (Direction dir = DIR_UP; dir <= DIR_RIGHT; dir++) {
+        int next[BOARD_HEIGHT][BOARD_WIDTH];
+        memcpy(next, snap->board, sizeof(next));
+        if (!engine_move(next, dir)) continue;
+
+        values[dir] = expect_chance(next, ANALYSIS_DEPTH, 1.0);
+        if (analysis_cancelled) return;
+        if (best == DIR_NONE || values[dir] > values[best]) best = dir;
+    }
+    if (best == DIR_NONE) return;
+
+    double loss = (values[best] - values[snap->played]) / values[best];
+    analyzed_moves++;
+    if (loss >= BLUNDER_THRESHOLD) {
+        record_blunder(snap, best, loss);
+    }
+
+    uint64_t loss_tenths = (uint64_t)(loss * 1000 + 0.5);
+    atomic_store(&analysis_result, ((uint64_t)snap->move_number << 32) | ((uint64_t)best << 24) | loss_tenths);
+}
+
+static void *analyzer_main(void *arg) {
+    (void)arg;
+    while (atomic_load(&analyzer_running)) {
+        if (!(atomic_load(&snapshot_middle) & SNAPSHOT_FRESH)) {
+            usleep(1000);
+            continue;
+        }
+        snapshot_front = atomic_exchange(&snapshot_middle, snapshot_front) & ~SNAPSHOT_FRESH;
+        analyze_snapshot(&snapshots[snapshot_front]);
+    }
+    return NULL;
+}
+
+static void publish_move(int before[BOARD_HEIGHT][BOARD_WIDTH], Direction played) {
+    MoveSnapshot *snap = &snapshots[snapshot_back];
+    memcpy(snap->board, before, sizeof(snap->board));
+    snap->played = played;
+    snap->move_number = ++move_number;
+    snap->game_number = game_number;
+
+    atomic_store(&latest_move, move_number);
+    snapshot_back = atomic_exchange(&snapshot_middle, snapshot_back | SNAPSHOT_FRESH) & ~SNAPSHOT_FRESH;
+}
+
+static void start_analyzer() {
+    atomic_store(&analyzer_running, true);
+    if (pthread_create(&analyzer_thread, NULL, analyzer_main, NULL) != 0) {
+        atomic_store(&analyzer_running, false);
+    }
+}
+
+static void stop_analyzer() {
+    if (!atomic_load(&analyzer_running)) return;
+    atomic_store(&analyzer_running, false);
+    atomic_fetch_add(&latest_move, 1);
+    pthread_join(analyzer_thread, NULL);
+
+    FILE *report = fopen(REPORT_FILE, "w");
+    if (!report) return;
+
+    fprintf(report, "Moves analyzed: %d\nBlunders (>= %.0f%% EV loss): %d\n", analyzed_moves, BLUNDER_THRESHOLD * 100, blunder_count);
+    unsigned int current_game = 0;
+    for (int i = 0; i < blunder_count; i++) {
+        if (blunders[i].game_number != current_game) {
+            current_game = blunders[i].game_number;
+            fprintf(report, "\nGame %u\n", current_game);
+        }
+        fprintf(report, "  move %4u: played %-5s best %-5s EV loss %.1f%%\n",
+            blunders[i].move_number, direction_names[blunders[i].played],
+            direction_names[blunders[i].best], blunders[i].loss * 100);
+    }
+    fclose(report);
+}
+
 static bool can_move() {
     for (int y = 0; y < BOARD_HEIGHT; y++) {
         for (int x = 0; x < BOARD_WIDTH; x++) {
@@ -325,6 +606,9 @@ static void process_input() {
     
     switch(key) {
         case 'q': case 'Q':
+            stop_analyzer();
+            out_close(&out);
+            stats_close(&stats);
             cleanup_terminal();
             printf("\nGame Over\n");
             exit(0);
@@ -337,14 +621,23 @@ static void process_input() {
             score = 0;
             game_over = false;
             won = false;
+            game_number++;
             init_board();
             break;
+        case 't': case 'T': stats_visible = !stats_visible; break;
     }
     
-    if (!game_over && new_direction != DIR_NONE) {
+    current_direction = new_direction;
+}
+
+// Plays the move process_input read, if any.
+static void update_game() {
+    if (!game_over && current_direction != DIR_NONE) {
         bool moved = false;
+        int before[BOARD_HEIGHT][BOARD_WIDTH];
+        memcpy(before, board, sizeof(before));
         
-        switch(new_direction) {
+        switch(current_direction) {
             case DIR_UP: moved = move_up(); break;
             case DIR_DOWN: moved = move_down(); break;
             case DIR_LEFT: moved = move_left(); break;
@@ -353,6 +646,7 @@ static void process_input() {
         }
         
         if (moved) {
+            publish_move(before, current_direction);
             add_random_tile();
             if (!can_move()) {
                 game_over = true;
@@ -360,80 +654,134 @@ static void process_input() {
         }
     }
     
-    current_direction = new_direction;
+    current_direction = DIR_NONE;
 }
 
 static void render() {
-    system(CLEAR_CMD);
+    out_printf(&out, CLEAR_SCREEN);
     
-    printf("Score: %d\n", score);
+    out_printf(&out, "Score: %d\n", score);
     if (won) {
-        printf("YOU WON! You reached 2048! Press 'r' to restart or 'q' to quit.\n");
+        out_printf(&out, "YOU WON! You reached 2048! Press 'r' to restart or 'q' to quit.\n");
     } else if (game_over) {
-        printf("GAME OVER! Press 'r' to restart or 'q' to quit.\n");
+        out_printf(&out, "GAME OVER! Press 'r' to restart or 'q' to quit.\n");
+    } else {
+        out_printf(&out, "Use WASD or arrow keys to move, 'q' to quit, 'r' to restart, 't' for frame stats\n");
+    }
+
+    uint64_t result = atomic_load(&analysis_result);
+    unsigned int analyzed_move = (unsigned int)(result >> 32);
+    if (move_number == 0) {
+        out_printf(&out, "Analysis: make a move\n");
+    } else if (analyzed_move != move_number) {
+        out_printf(&out, "Analysis: move %u ...\n", move_number);
     } else {
-        printf("Use WASD or arrow keys to move, 'q' to quit, 'r' to restart\n");
+        int best = (int)((result >> 24) & 0xff);
+        double loss = (result & 0xffffff) / 10.0;
+        if (loss < 0.05) {
+            out_printf(&out, "Analysis: move %u was the best move\n", analyzed_move);
+        } else {
+            out_printf(&out, "Analysis: move %u lost %.1f%% EV (best was %s)\n", analyzed_move, loss, direction_names[best]);
+        }
     }
-    printf("\n");
+    out_printf(&out, "\n");
     
-    printf("┌");
+    out_printf(&out, "┌");
     for (int x = 0; x < BOARD_WIDTH; x++) {
-        printf("─────┬");
+        out_printf(&out, "─────┬");
     }
-    printf("\b┐\n");
+    out_printf(&out, "\b┐\n");
     
     for (int y = 0; y < BOARD_HEIGHT; y++) {
-        printf("│");
+        out_printf(&out, "│");
         for (int x = 0; x < BOARD_WIDTH; x++) {
             int value = board[y][x];
             if (value == 0) {
-                printf("     │");
+                out_printf(&out, "     │");
             } else {
                 switch(value) {
-                    case 2: printf("\033[30;47m%4d\033[0m │", value); break;
-                    case 4: printf("\033[30;43m%4d\033[0m │", value); break;
-                    case 8: printf("\033[30;42m%4d\033[0m │", value); break;
-                    case 16: printf("\033[30;41m%4d\033[0m │", value); break;
-                    case 32: printf("\033[30;44m%4d\033[0m │", value); break;
-                    case 64: printf("\033[30;45m%4d\033[0m │", value); break;
-                    case 128: printf("\033[30;46m%4d\033[0m │", value); break;
-                    case 256: printf("\033[30;100m%4d\033[0m │", value); break;
-                    case 512: printf("\033[30;101m%4d\033[0m │", value); break;
-                    case 1024: printf("\033[30;102m%4d\033[0m │", value); break;
-                    case 2048: printf("\033[30;103m%4d\033[0m │", value); break;
-                    default: printf("%5d │", value); break;
+                    case 2: out_printf(&out, "\033[30;47m%4d\033[0m │", value); break;
+                    case 4: out_printf(&out, "\033[30;43m%4d\033[0m │", value); break;
+                    case 8: out_printf(&out, "\033[30;42m%4d\033[0m │", value); break;
+                    case 16: out_printf(&out, "\033[30;41m%4d\033[0m │", value); break;
+                    case 32: out_printf(&out, "\033[30;44m%4d\033[0m │", value); break;
+                    case 64: out_printf(&out, "\033[30;45m%4d\033[0m │", value); break;
+                    case 128: out_printf(&out, "\033[30;46m%4d\033[0m │", value); break;
+                    case 256: out_printf(&out, "\033[30;100m%4d\033[0m │", value); break;
+                    case 512: out_printf(&out, "\033[30;101m%4d\033[0m │", value); break;
+                    case 1024: out_printf(&out, "\033[30;102m%4d\033[0m │", value); break;
+                    case 2048: out_printf(&out, "\033[30;103m%4d\033[0m │", value); break;
+                    default: out_printf(&out, "%5d │", value); break;
             }
                 }
         }
-        printf("\n");
+        out_printf(&out, "\n");
         
         if (y < BOARD_HEIGHT - 1) {
-            printf("├");
+            out_printf(&out, "├");
             for (int x = 0; x < BOARD_WIDTH; x++) {
-                printf("─────┼");
+                out_printf(&out, "─────┼");
             }
-            printf("\b┤\n");
+            out_printf(&out, "\b┤\n");
         }
     }
     
-    printf("└");
+    out_printf(&out, "└");
     for (int x = 0; x < BOARD_WIDTH; x++) {
-        printf("─────┴");
+        out_printf(&out, "─────┴");
+    }
+    out_printf(&out, "\b┘\n");
+    out_printf(&out, "Frames dropped: %ld  Output: %.1f KB/s\n", out.frames_dropped, out.bytes_per_second / 1024);
+
+    if (stats_visible) {
+        char line[128];
+        out_printf(&out, "\n");
+        for (int i = 0; i < STATS_OVERLAY_LINES; i++) {
+            stats_overlay_line(&stats, i, line, sizeof(line));
+            out_printf(&out, "%s\n", line);
+        }
     }
-    printf("\b┘\n");
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+    const char *stats_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats-file") == 0 && i + 1 < argc) stats_path = argv[++i];
+    }
+    if (!stats_open(&stats, stats_path)) {
+        printf("Could not open %s for writing\n", stats_path);
+        return 1;
+    }
+
     srand(time(NULL));  
     setup_terminal();
     init_board();
+    start_analyzer();
+    out_init(&out, STDOUT_FILENO);
     
+    // Redrawn every tick so analysis results show up as they arrive. A tick
+    // whose frame the terminal is not ready for skips drawing it.
     while (true) {
+        long long tick_start = stats_now_ns();
         process_input();
-        render();
+        long long input_done = stats_now_ns();
+        update_game();
+        long long update_done = stats_now_ns();
+        if (out_ready(&out)) {
+            long long build_start = stats_now_ns();
+            render();
+            long long build_done = stats_now_ns();
+            out_submit(&out);
+            stats_record_frame(&stats, input_done - tick_start, update_done - input_done, build_start, build_done,
+                out.bytes_written, out.syscalls);
+        } else {
+            out.frames_dropped++;
+        }
         usleep(MICROSECONDS_PER_TICK);
     }
     
+    out_close(&out);
+    stats_close(&stats);
     cleanup_terminal();
     return 0;
 }
\ No newline at end of file
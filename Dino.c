@@ -1,42 +1,139 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include <unistd.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "triple_buffer.h"
+#include "term_output.h"
+#include "frame_stats.h"
+#include "game_loop.h"
 
 #ifdef _WIN32
     #include <conio.h>
     #include <windows.h>
-    #define CLEAR_CMD "cls"
 #else
     #include <termios.h>
     #include <fcntl.h>
-    #define CLEAR_CMD "clear"
+    #include <sys/ioctl.h>
 #endif
 
 #define TICK_RATE 60
 #define MICROSECONDS_PER_TICK (1000000 / TICK_RATE)
-#define FLOOR_LENGTH 50
+#define DEFAULT_FIELD_WIDTH 50
+#define MIN_FIELD_WIDTH 20
 #define GAME_HEIGHT 5
 #define DINO_X_POSITION 5
 #define MAX_JUMP_HEIGHT 3
-#define MAX_OBSTACLES 10
-#define MIN_OBSTACLE_SPACING 8
-#define OBSTACLE_SPAWN_CHANCE 5
+#define MIN_OBSTACLE_SPACING 4
+#define OBSTACLE_SPAWN_CHANCE 10
+#define CHUNK_COLUMNS 64
+#define SCROLL_TICKS 2
+#define SPEED_LEVEL_TICKS 1800
+#define MAX_SPEED_LEVEL 4
+#define SENSE_RANGE 50
+#define FIELD_TOP 3
+#define FIELD_LEFT 2
+#define OVERLAY_TOP (FIELD_TOP + GAME_HEIGHT + 4)
+#define JUMP_TICKS 10
+#define CLEAR_SCREEN "\033[H\033[2J"
+#define GENOME_FILE "dino_genome.txt"
+#define NET_INPUTS 5
+#define NET_HIDDEN 6
+#define NET_WEIGHTS (NET_INPUTS * NET_HIDDEN + NET_HIDDEN + 1)
+#define TRAIN_AGENTS 2000
+#define TRAIN_TICKS 20000
+#define TRAIN_BLOCK 256
+#define TRAIN_ELITE_PERCENT 10
+#define TRAIN_MUTATION_RATE 20
+#define TRAIN_MAX_THREADS 16
 
+// What the render thread needs from one tick: the camera, the dino and the
+// obstacle columns on screen, oldest first. The sequence number is the world
+// tick. Each slot owns its obstacle array.
 typedef struct {
-    int x;
-    bool active;
-    int move_timer;
-} Obstacle;
+    FrameInfo info;
+    bool stats_visible;
+    long camera_x;
+    int dino_y;
+    int score;
+    int speed_level;
+    int obstacle_count;
+    long *obstacles;
+} Snapshot;
 
 static struct termios original_termios;
 bool jumping = false;
 int ticks_since_jump = 0;
-Obstacle obstacles[MAX_OBSTACLES];
-int last_obstacle_x = FLOOR_LENGTH + MIN_OBSTACLE_SPACING;
 int score = 0;
 
+// The world is an endless strip of columns, generated CHUNK_COLUMNS at a time
+// just ahead of the camera from world_seed and the chunk's index. Obstacles
+// are world columns held oldest first in a ring queue: new ones join at the
+// back as chunks are generated and leave from the front once off screen, so
+// the queue stays sorted. column_bits mirrors the queue as one bit per world
+// column, indexed modulo its size, for O(1) lookups while drawing.
+static int field_width = DEFAULT_FIELD_WIDTH;
+static long camera_x = 0;
+static long generated_until = 0;
+static long last_obstacle_x = 0;
+static uint32_t world_seed = 1;
+static long world_tick = 0;
+static int speed_level = 1;
+static int scroll_progress = 0;
+static int world_scrolled = 0;
+static long *obstacle_queue = NULL;
+static int queue_mask = 0;
+static int queue_front = 0;
+static int queue_count = 0;
+static uint64_t *column_bits = NULL;
+static long column_mask = 0;
+static bool field_drawn = false;
+static int drawn_dino_y = -1;
+static long drawn_camera_x = 0;
+static bool overlay_drawn = false;
+static bool stats_visible = false;
+
+// The simulation runs on its own thread at TICK_RATE and publishes a Snapshot
+// after each tick; the render thread draws the newest one it finds, so a slow
+// terminal costs frames rather than slowing the obstacles down. A collision
+// or the quit key only sets a flag; running is cleared after the tick's
+// snapshot is published, so the final frame always reaches the screen.
+static Snapshot snapshot_slots[3];
+static TripleBuffer snapshots;
+static atomic_bool running;
+static bool collided = false;
+static bool quit_requested = false;
+static TermOutput out;
+static FrameStats stats;
+
+static const char *genome_path = GENOME_FILE;
+static bool autoplay = false;
+static float autoplay_genome[NET_WEIGHTS];
+
+// Trainer state. Every agent in a generation faces one recorded obstacle
+// stream: stream_gap_*[t], stream_phase[t] and stream_speed[t] are what a
+// player sees before tick t, and stream_hit[t] whether the dino's column met
+// an obstacle during it. Agents are stored as parallel arrays and genomes weight-major, so
+// genomes[w * agent_count + a] is weight w of agent a and the policy can be
+// evaluated for a run of agents with contiguous loads.
+static int agent_count = TRAIN_AGENTS;
+static float *stream_gap_near = NULL;
+static float *stream_gap_far = NULL;
+static float *stream_phase = NULL;
+static float *stream_speed = NULL;
+static uint8_t *stream_hit = NULL;
+static float *genomes = NULL;
+static float *next_genomes = NULL;
+static uint8_t *agent_jumping = NULL;
+static uint8_t *agent_ticks_since_jump = NULL;
+static int *agent_fitness = NULL;
+static int *agent_order = NULL;
+static atomic_int next_block;
+
 
 #ifndef _WIN32
 static void setup_terminal() {
@@ -88,60 +185,102 @@ static char read_char() {
 }
 #endif
 
-static void init_obstacles() {
-    for (int i = 0; i < MAX_OBSTACLES; i++) {
-        obstacles[i].active = false;
-        obstacles[i].x = 0;
-        obstacles[i].move_timer = 0;
-    }
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
 }
 
-static void spawn_obstacle() {
-    if (last_obstacle_x < MIN_OBSTACLE_SPACING) {
-        return;
-    }
-    if (rand() % 100 >= OBSTACLE_SPAWN_CHANCE) {
-        return;
+static inline bool column_has_obstacle(long x) {
+    return (column_bits[(x & column_mask) / 64] >> (x & 63)) & 1;
+}
+
+static inline long queue_at(int i) {
+    return obstacle_queue[(queue_front + i) & queue_mask];
+}
+
+// Sizes the obstacle ring and column bitmap to everything that can exist at
+// once: the visible field plus the chunk generated ahead of it.
+static void init_world_buffers() {
+    long window = 64;
+    while (window < field_width + 2 * CHUNK_COLUMNS) window <<= 1;
+    column_mask = window - 1;
+    queue_mask = (int) window - 1;
+    column_bits = calloc(window / 64, sizeof(uint64_t));
+    obstacle_queue = malloc(window * sizeof(long));
+    if (!column_bits || !obstacle_queue) {
+        fprintf(stderr, "Not enough memory for a %d column field\n", field_width);
+        exit(1);
     }
+}
 
-    for (int i = 0; i < MAX_OBSTACLES; i++) {
-        if (!obstacles[i].active) {
-            obstacles[i].active = true;
-            obstacles[i].x = FLOOR_LENGTH - 1;
-            obstacles[i].move_timer = 0;
-            last_obstacle_x = 0; 
-            break;
+static void reset_world(uint32_t seed) {
+    memset(column_bits, 0, (column_mask + 1) / 64 * sizeof(uint64_t));
+    world_seed = seed;
+    camera_x = 0;
+    generated_until = field_width;
+    last_obstacle_x = field_width;
+    world_tick = 0;
+    speed_level = 1;
+    scroll_progress = 0;
+    world_scrolled = 0;
+    queue_front = 0;
+    queue_count = 0;
+}
+
+static void spawn_obstacle(long x) {
+    obstacle_queue[(queue_front + queue_count) & queue_mask] = x;
+    queue_count++;
+    column_bits[(x & column_mask) / 64] |= 1ULL << (x & 63);
+    last_obstacle_x = x;
+}
+
+// A chunk's layout depends only on the seed, its index and where the chunk
+// before it put its last obstacle, so chunks can be made as they are needed.
+static void generate_chunk(long chunk) {
+    uint32_t state = (world_seed ^ (uint32_t) chunk * 2654435761u) | 1;
+    long end = (chunk + 1) * CHUNK_COLUMNS;
+    for (long x = chunk * CHUNK_COLUMNS; x < end; x++) {
+        if (x < generated_until) continue;
+        if (x - last_obstacle_x >= MIN_OBSTACLE_SPACING &&
+            (int) (next_random(&state) % 100) < OBSTACLE_SPAWN_CHANCE) {
+            spawn_obstacle(x);
         }
     }
+    generated_until = end;
 }
 
+// Scrolls the camera by the columns due this tick, retires obstacles that
+// left the screen and generates whatever the field now reaches into.
 static void update_obstacles() {
-    last_obstacle_x++;
-    
-    for (int i = 0; i < MAX_OBSTACLES; i++) {
-        if (obstacles[i].active) {
-            obstacles[i].move_timer++;
+    world_tick++;
+    speed_level = 1 + world_tick / SPEED_LEVEL_TICKS;
+    if (speed_level > MAX_SPEED_LEVEL) speed_level = MAX_SPEED_LEVEL;
 
-            if (obstacles[i].move_timer >= 2) {
-                obstacles[i].x--;
-                obstacles[i].move_timer = 0;
-            }
-            
-            if (obstacles[i].x < 0) {
-                obstacles[i].active = false;
-            }
-        }
+    scroll_progress += speed_level;
+    world_scrolled = scroll_progress / SCROLL_TICKS;
+    scroll_progress %= SCROLL_TICKS;
+    camera_x += world_scrolled;
+
+    while (queue_count > 0 && queue_at(0) < camera_x) {
+        long x = queue_at(0);
+        column_bits[(x & column_mask) / 64] &= ~(1ULL << (x & 63));
+        queue_front = (queue_front + 1) & queue_mask;
+        queue_count--;
+    }
+    while (generated_until < camera_x + field_width) {
+        generate_chunk(generated_until / CHUNK_COLUMNS);
     }
-    
-    spawn_obstacle();
 }
 
-static int get_dino_y_position() {
-    if (!jumping) {
+static int dino_y_for(bool is_jumping, int jump_progress) {
+    if (!is_jumping) {
         return GAME_HEIGHT - 1;
     }
     
-    int jump_progress = ticks_since_jump;
     int half_jump = 5;
     
     if (jump_progress <= half_jump) {
@@ -152,19 +291,60 @@ static int get_dino_y_position() {
     }
 }
 
-static bool check_collision() {
-    int dino_y = get_dino_y_position();
-    
-    for (int i = 0; i < MAX_OBSTACLES; i++) {
-        if (obstacles[i].active) {
-            if (obstacles[i].x == DINO_X_POSITION && dino_y == GAME_HEIGHT - 1) {
-                return true;
-            }
-        }
+static int get_dino_y_position() {
+    return dino_y_for(jumping, ticks_since_jump);
+}
+
+// Whether the dino's column met an obstacle this tick, including any columns
+// it was carried past when the world scrolled more than one. Only the few
+// obstacles between the left edge and the dino are looked at.
+static bool dino_column_hit() {
+    long dino_x = camera_x + DINO_X_POSITION;
+    long first = dino_x - (world_scrolled > 1 ? world_scrolled - 1 : 0);
+    for (int i = 0; i < queue_count; i++) {
+        long x = queue_at(i);
+        if (x > dino_x) break;
+        if (x >= first) return true;
     }
     return false;
 }
 
+static bool check_collision() {
+    return get_dino_y_position() == GAME_HEIGHT - 1 && dino_column_hit();
+}
+
+// What the policy sees: how far the next two obstacles are within
+// SENSE_RANGE, the scroll step and the speed level, all scaled to about 0..1.
+static void policy_inputs(float inputs[NET_INPUTS]) {
+    long dino_x = camera_x + DINO_X_POSITION;
+    long gaps[2] = {SENSE_RANGE, SENSE_RANGE};
+    int found = 0;
+    for (int i = 0; i < queue_count && found < 2; i++) {
+        long gap = queue_at(i) - dino_x;
+        if (gap < 0) continue;
+        gaps[found++] = gap < SENSE_RANGE ? gap : SENSE_RANGE;
+    }
+    inputs[0] = (float) gaps[0] / SENSE_RANGE;
+    inputs[1] = (float) gaps[1] / SENSE_RANGE;
+    inputs[2] = (float) scroll_progress / SCROLL_TICKS;
+    inputs[3] = (float) speed_level / MAX_SPEED_LEVEL;
+    inputs[4] = 1.0f;
+}
+
+// One hidden layer with a softsign activation, which unlike tanh vectorizes.
+// Weight k of the genome is weights[k * stride]. Jump when the output is
+// positive.
+static float policy_output(const float *weights, size_t stride, const float inputs[NET_INPUTS]) {
+    const float *out = weights + (size_t) NET_INPUTS * NET_HIDDEN * stride;
+    float result = out[NET_HIDDEN * stride];
+    for (int h = 0; h < NET_HIDDEN; h++) {
+        float sum = 0;
+        for (int i = 0; i < NET_INPUTS; i++) sum += weights[(i * NET_HIDDEN + h) * stride] * inputs[i];
+        result += out[h * stride] * (sum / (1.0f + (sum < 0 ? -sum : sum)));
+    }
+    return result;
+}
+
 
 
 static void process_input() {
@@ -174,9 +354,7 @@ static void process_input() {
     
     switch (key) {
         case 'q': case 'Q':
-            cleanup_terminal();
-            printf("\nGame Over\n");
-            exit(0);
+            quit_requested = true;
             break;
         case ' ':
             if (!jumping) {
@@ -184,14 +362,24 @@ static void process_input() {
                 ticks_since_jump = 0;
             }
             break;
+        case 't': case 'T':
+            stats_visible = !stats_visible;
+            break;
     }
 }
 
 static void update_game() {
-    process_input();
+    if (autoplay && !jumping) {
+        float inputs[NET_INPUTS];
+        policy_inputs(inputs);
+        if (policy_output(autoplay_genome, 1, inputs) > 0) {
+            jumping = true;
+            ticks_since_jump = 0;
+        }
+    }
     
     if (jumping) {
-        if (ticks_since_jump >= 10) {
+        if (ticks_since_jump >= JUMP_TICKS) {
             jumping = false;
             ticks_since_jump = 0;
         } else {
@@ -201,74 +389,447 @@ static void update_game() {
     
     update_obstacles();
     
-    if (check_collision()) {
-        cleanup_terminal();
-        printf("\nCOLLISION! Game Over\n");
-        exit(0);
+    if (check_collision()) collided = true;
+}
+
+static bool snapshot_has_obstacle(const Snapshot *snap, long x) {
+    int low = 0, high = snap->obstacle_count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (snap->obstacles[mid] < x) low = mid + 1;
+        else high = mid;
     }
+    return low < snap->obstacle_count && snap->obstacles[low] == x;
 }
 
-static void render_frame() {
-    system(CLEAR_CMD);
-    
-    printf("\n");
-    
-    printf("┌");
-    for (int x = 0; x < FLOOR_LENGTH; x++) printf("──");
-    printf("┐\n");
+static const char *field_cell(const Snapshot *snap, int x, int y) {
+    if (y == GAME_HEIGHT - 1 && snapshot_has_obstacle(snap, snap->camera_x + x)) return "\033[32m|\033[0m ";
+    if (x == DINO_X_POSITION && y == snap->dino_y) return "@ ";
+    return "  ";
+}
+
+static void draw_cell(const Snapshot *snap, int x, int y) {
+    const char *cell = field_cell(snap, x, y);
+    out_append(&out, cell, strlen(cell));
+}
+
+static void terminal_size(int *cols, int *rows) {
+    *cols = 80;
+    *rows = 24;
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        *cols = info.srWindow.Right - info.srWindow.Left + 1;
+        *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    }
+#else
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+        *cols = ws.ws_col;
+        *rows = ws.ws_row;
+    }
+#endif
+}
+
+static void draw_full_frame(const Snapshot *snap) {
+    out_printf(&out, CLEAR_SCREEN "\n");
     
-    int dino_y = get_dino_y_position();
+    out_printf(&out, "┌");
+    for (int x = 0; x < field_width; x++) out_printf(&out, "──");
+    out_printf(&out, "┐\n");
     
     for (int y = 0; y < GAME_HEIGHT; y++) {
-        printf("│");
-        for (int x = 0; x < FLOOR_LENGTH; x++) {
-            bool obstacle_here = false;
-            
-            for (int i = 0; i < MAX_OBSTACLES; i++) {
-                if (obstacles[i].active && obstacles[i].x == x && y == GAME_HEIGHT - 1) {
-                    printf("\033[32m|\033[0m ");
-                    obstacle_here = true;
-                    break;
-                }
+        out_printf(&out, "│");
+        for (int x = 0; x < field_width; x++) {
+            draw_cell(snap, x, y);
+        }
+        out_printf(&out, "│\n");
+    }
+
+    out_printf(&out, "└");
+    for (int x = 0; x < field_width; x++) out_printf(&out, "──");
+    out_printf(&out, "┘\n");
+    
+    out_printf(&out, "Score: %d  Speed: %d  Dropped: %ld  Output: %.1f KB/s\n", snap->score, snap->speed_level,
+        out.frames_dropped, out.bytes_per_second / 1024);
+    out_printf(&out, "Controls: Space to jump, T for frame stats, Q to quit%s\n", autoplay ? " (autoplay on)" : "");
+    overlay_drawn = false;
+}
+
+// The stats overlay sits under the controls. Once hidden it is cleared the
+// next frame and then left alone.
+static void draw_overlay(const Snapshot *snap) {
+    if (snap->stats_visible) {
+        char line[128];
+        for (int i = 0; i < STATS_OVERLAY_LINES; i++) {
+            stats_overlay_line(&stats, i, line, sizeof(line));
+            out_printf(&out, "\033[%d;1H%s\033[K", OVERLAY_TOP + i, line);
+        }
+        overlay_drawn = true;
+    } else if (overlay_drawn) {
+        out_printf(&out, "\033[%d;1H\033[J", OVERLAY_TOP);
+        overlay_drawn = false;
+    }
+}
+
+// After the first frame only what changed is sent. When the world has
+// scrolled since the last frame drawn, each field row has the cells that left
+// the screen deleted so the rest of the row, border included, slides left;
+// then the columns that came into view on the right are filled in and the
+// dino is moved. A frame costs the same however wide the field is, and a
+// skipped snapshot only makes the next frame scroll further.
+static void render_frame(const void *snapshot) {
+    const Snapshot *snap = snapshot;
+    long scrolled = snap->camera_x - drawn_camera_x;
+
+    if (!field_drawn || scrolled >= field_width) {
+        draw_full_frame(snap);
+        field_drawn = true;
+        drawn_dino_y = snap->dino_y;
+        drawn_camera_x = snap->camera_x;
+        draw_overlay(snap);
+        out_printf(&out, "\033[%d;1H", FIELD_TOP + GAME_HEIGHT + 3);
+        return;
+    }
+
+    long under_dino = drawn_camera_x + DINO_X_POSITION;
+    bool covered = drawn_dino_y == GAME_HEIGHT - 1 && snapshot_has_obstacle(snap, under_dino);
+    out_printf(&out, "\033[%d;%dH%s", FIELD_TOP + drawn_dino_y, FIELD_LEFT + 2 * DINO_X_POSITION,
+        covered ? "\033[32m|\033[0m " : "  ");
+    if (scrolled > 0) {
+        for (int y = 0; y < GAME_HEIGHT; y++) {
+            out_printf(&out, "\033[%d;%dH\033[%ldP", FIELD_TOP + y, FIELD_LEFT, 2 * scrolled);
+            out_printf(&out, "\033[%d;%ldH", FIELD_TOP + y, FIELD_LEFT + 2 * (field_width - scrolled));
+            for (int x = field_width - (int) scrolled; x < field_width; x++) {
+                draw_cell(snap, x, y);
             }
-            
-            if (!obstacle_here) {
-                if (x == DINO_X_POSITION && y == dino_y) {
-                    printf("@ ");
+            out_printf(&out, "│");
+        }
+    }
+    out_printf(&out, "\033[%d;%dH@ ", FIELD_TOP + snap->dino_y, FIELD_LEFT + 2 * DINO_X_POSITION);
+    drawn_dino_y = snap->dino_y;
+    drawn_camera_x = snap->camera_x;
+
+    out_printf(&out, "\033[%d;1HScore: %d  Speed: %d  Dropped: %ld  Output: %.1f KB/s\033[K", FIELD_TOP + GAME_HEIGHT + 1,
+        snap->score, snap->speed_level, out.frames_dropped, out.bytes_per_second / 1024);
+    draw_overlay(snap);
+    out_printf(&out, "\033[%d;1H", FIELD_TOP + GAME_HEIGHT + 3);
+}
+
+static void init_snapshots() {
+    for (int i = 0; i < 3; i++) {
+        snapshot_slots[i].obstacles = malloc((size_t) (queue_mask + 1) * sizeof(long));
+        if (!snapshot_slots[i].obstacles) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    triple_init(&snapshots, snapshot_slots, sizeof(Snapshot));
+}
+
+static void publish_snapshot(long input_ns, long update_ns) {
+    Snapshot *snap = triple_back(&snapshots);
+    snap->info.sequence = world_tick;
+    snap->info.input_ns = input_ns;
+    snap->info.update_ns = update_ns;
+    snap->stats_visible = stats_visible;
+    snap->camera_x = camera_x;
+    snap->dino_y = get_dino_y_position();
+    snap->score = score;
+    snap->speed_level = speed_level;
+    snap->obstacle_count = 0;
+    for (int i = 0; i < queue_count && queue_at(i) < camera_x + field_width; i++) {
+        snap->obstacles[snap->obstacle_count++] = queue_at(i);
+    }
+    triple_publish(&snapshots);
+}
+
+static void *simulation_thread(void *arg) {
+    (void) arg;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    while (atomic_load(&running)) {
+        long long tick_start = stats_now_ns();
+        process_input();
+        long long input_done = stats_now_ns();
+        score++;
+        update_game();
+        publish_snapshot(input_done - tick_start, stats_now_ns() - input_done);
+        if (quit_requested || collided) {
+            atomic_store(&running, false);
+            break;
+        }
+        loop_wait_for_tick(&deadline, MICROSECONDS_PER_TICK);
+    }
+    return NULL;
+}
+
+static RenderLoop render_loop = {&snapshots, &out, &stats, &running, render_frame};
+
+static float random_weight(uint32_t *state, float scale) {
+    return ((float) (next_random(state) & 0xFFFF) / 0x8000 - 1.0f) * scale;
+}
+
+static int thread_count() {
+#ifndef _WIN32
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    long count = 4;
+#endif
+    if (count < 1) count = 1;
+    if (count > TRAIN_MAX_THREADS) count = TRAIN_MAX_THREADS;
+    return (int) count;
+}
+
+// Plays the real world generator for TRAIN_TICKS ticks from a fixed seed and
+// records what each agent will see and hit.
+static void record_stream(uint32_t seed) {
+    reset_world(seed);
+
+    for (int t = 0; t < TRAIN_TICKS; t++) {
+        float inputs[NET_INPUTS];
+        policy_inputs(inputs);
+        stream_gap_near[t] = inputs[0];
+        stream_gap_far[t] = inputs[1];
+        stream_phase[t] = inputs[2];
+        stream_speed[t] = inputs[3];
+        update_obstacles();
+        stream_hit[t] = dino_column_hit();
+    }
+}
+
+// Runs up to TRAIN_BLOCK agents through the stream in lockstep. The policy is
+// evaluated for the whole block each tick with loops over agents innermost,
+// until so few are left that evaluating just the survivors one by one is
+// cheaper. The jump and collision rules then match update_game exactly.
+static void evaluate_block(int first, int count) {
+    float sum[TRAIN_BLOCK], output[TRAIN_BLOCK];
+    int alive = count;
+
+    for (int k = 0; k < count; k++) {
+        agent_jumping[first + k] = 0;
+        agent_ticks_since_jump[first + k] = 0;
+        agent_fitness[first + k] = -1;
+    }
+
+    for (int t = 0; t < TRAIN_TICKS && alive > 0; t++) {
+        float inputs[NET_INPUTS] = {stream_gap_near[t], stream_gap_far[t], stream_phase[t], stream_speed[t], 1.0f};
+        const float *out = genomes + (size_t) NET_INPUTS * NET_HIDDEN * agent_count + first;
+        bool sparse = alive * 4 < count;
+
+        for (int k = 0; k < count && !sparse; k++) output[k] = out[(size_t) NET_HIDDEN * agent_count + k];
+        for (int h = 0; h < NET_HIDDEN && !sparse; h++) {
+            for (int k = 0; k < count; k++) sum[k] = 0;
+            for (int i = 0; i < NET_INPUTS; i++) {
+                const float *w = genomes + (size_t) (i * NET_HIDDEN + h) * agent_count + first;
+                for (int k = 0; k < count; k++) sum[k] += w[k] * inputs[i];
+            }
+            const float *w = out + (size_t) h * agent_count;
+            for (int k = 0; k < count; k++) {
+                output[k] += w[k] * (sum[k] / (1.0f + (sum[k] < 0 ? -sum[k] : sum[k])));
+            }
+        }
+
+        for (int k = 0; k < count; k++) {
+            int a = first + k;
+            if (agent_fitness[a] >= 0) continue;
+            if (sparse) output[k] = policy_output(genomes + a, agent_count, inputs);
+            if (!agent_jumping[a] && output[k] > 0) {
+                agent_jumping[a] = 1;
+                agent_ticks_since_jump[a] = 0;
+            }
+            if (agent_jumping[a]) {
+                if (agent_ticks_since_jump[a] >= JUMP_TICKS) {
+                    agent_jumping[a] = 0;
+                    agent_ticks_since_jump[a] = 0;
                 } else {
-                    printf("  ");
+                    agent_ticks_since_jump[a]++;
                 }
             }
+            if (stream_hit[t] && dino_y_for(agent_jumping[a], agent_ticks_since_jump[a]) == GAME_HEIGHT - 1) {
+                agent_fitness[a] = t;
+                alive--;
+            }
         }
-        printf("│\n");
     }
+    for (int k = 0; k < count; k++) {
+        if (agent_fitness[first + k] < 0) agent_fitness[first + k] = TRAIN_TICKS;
+    }
+}
+
+static void *train_worker(void *arg) {
+    (void) arg;
+    int block;
+    while ((block = atomic_fetch_add(&next_block, 1)) * TRAIN_BLOCK < agent_count) {
+        int first = block * TRAIN_BLOCK;
+        int count = agent_count - first < TRAIN_BLOCK ? agent_count - first : TRAIN_BLOCK;
+        evaluate_block(first, count);
+    }
+    return NULL;
+}
 
-    printf("└");
-    for (int x = 0; x < FLOOR_LENGTH; x++) printf("──");
-    printf("┘\n");
+static int compare_fitness(const void *a, const void *b) {
+    return agent_fitness[*(const int *) b] - agent_fitness[*(const int *) a];
+}
 
-    int active_obstacles = 0;
-    for (int i = 0; i < MAX_OBSTACLES; i++) {
-        if (obstacles[i].active) active_obstacles++;
+static void save_genome(const float *weights, size_t stride) {
+    FILE *file = fopen(genome_path, "w");
+    if (!file) return;
+    fprintf(file, "%d\n", NET_WEIGHTS);
+    for (int w = 0; w < NET_WEIGHTS; w++) fprintf(file, "%.9g\n", weights[w * stride]);
+    fclose(file);
+}
+
+static bool load_genome(float weights[NET_WEIGHTS]) {
+    FILE *file = fopen(genome_path, "r");
+    int count = 0;
+    if (!file) return false;
+    bool ok = fscanf(file, "%d", &count) == 1 && count == NET_WEIGHTS;
+    for (int w = 0; w < NET_WEIGHTS && ok; w++) ok = fscanf(file, "%f", &weights[w]) == 1;
+    fclose(file);
+    return ok;
+}
+
+// Evolves policies headless. Each generation faces a fresh obstacle stream;
+// agents are scored by ticks survived, the top TRAIN_ELITE_PERCENT carry over
+// unchanged and the rest are mutated copies of them. The best genome seen is
+// written to genome_path whenever it improves.
+static void run_trainer(int generations) {
+    size_t weights = (size_t) NET_WEIGHTS * agent_count;
+    stream_gap_near = malloc(TRAIN_TICKS * sizeof(float));
+    stream_gap_far = malloc(TRAIN_TICKS * sizeof(float));
+    stream_phase = malloc(TRAIN_TICKS * sizeof(float));
+    stream_speed = malloc(TRAIN_TICKS * sizeof(float));
+    stream_hit = malloc(TRAIN_TICKS);
+    genomes = malloc(weights * sizeof(float));
+    next_genomes = malloc(weights * sizeof(float));
+    agent_jumping = malloc(agent_count);
+    agent_ticks_since_jump = malloc(agent_count);
+    agent_fitness = malloc(agent_count * sizeof(int));
+    agent_order = malloc(agent_count * sizeof(int));
+    if (!stream_gap_near || !stream_gap_far || !stream_phase || !stream_speed || !stream_hit || !genomes ||
+        !next_genomes || !agent_jumping || !agent_ticks_since_jump || !agent_fitness || !agent_order) {
+        fprintf(stderr, "Not enough memory for %d agents\n", agent_count);
+        exit(1);
     }
-    
-    printf("Score: %d\n", score);
-    printf("Controls: Space to jump, Q to quit\n");
+
+    uint32_t seed = 0x9E3779B9u;
+    for (size_t i = 0; i < weights; i++) genomes[i] = random_weight(&seed, 1.0f);
+
+    int best_ever = -1;
+    int elite = agent_count * TRAIN_ELITE_PERCENT / 100;
+    if (elite < 1) elite = 1;
+
+    for (int generation = 0; generation < generations; generation++) {
+        record_stream((uint32_t) (1000 + generation) * 2654435761u | 1);
+
+        struct timespec begin, end;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        pthread_t threads[TRAIN_MAX_THREADS];
+        int started = 0;
+        atomic_store(&next_block, 0);
+        while (started < thread_count() - 1 && pthread_create(&threads[started], NULL, train_worker, NULL) == 0) started++;
+        train_worker(NULL);
+        for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+
+        long agent_ticks = 0;
+        for (int a = 0; a < agent_count; a++) {
+            agent_order[a] = a;
+            agent_ticks += agent_fitness[a];
+        }
+        qsort(agent_order, agent_count, sizeof(int), compare_fitness);
+        int best = agent_order[0];
+        if (agent_fitness[best] > best_ever) {
+            best_ever = agent_fitness[best];
+            save_genome(genomes + best, agent_count);
+        }
+        printf("Generation %d: best %d ticks, mean %.0f, %.0f agent-ticks/sec\n",
+            generation + 1, agent_fitness[best], (double) agent_ticks / agent_count,
+            seconds > 0 ? agent_ticks / seconds : 0);
+
+        for (int a = 0; a < agent_count; a++) {
+            int parent = a < elite ? agent_order[a] : agent_order[next_random(&seed) % elite];
+            for (int w = 0; w < NET_WEIGHTS; w++) {
+                float value = genomes[(size_t) w * agent_count + parent];
+                if (a >= elite && (int) (next_random(&seed) % 100) < TRAIN_MUTATION_RATE) {
+                    value += random_weight(&seed, 0.5f);
+                }
+                next_genomes[(size_t) w * agent_count + a] = value;
+            }
+        }
+        float *swap = genomes;
+        genomes = next_genomes;
+        next_genomes = swap;
+    }
+    printf("Best genome (%d ticks) saved to %s\n", best_ever, genome_path);
 }
 
-int main() {
-    srand(time(NULL));
+int main(int argc, char *argv[]) {
+    int generations = 0, requested_width = 0;
+    const char *stats_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--train") == 0 && i + 1 < argc) {
+            generations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--agents") == 0 && i + 1 < argc) {
+            agent_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--genome") == 0 && i + 1 < argc) {
+            genome_path = argv[++i];
+        } else if (strcmp(argv[i], "--autoplay") == 0) {
+            autoplay = true;
+        } else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            requested_width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stats-file") == 0 && i + 1 < argc) {
+            stats_path = argv[++i];
+        }
+    }
+    if (generations > 0) {
+        if (agent_count < 2) agent_count = 2;
+        init_world_buffers();
+        run_trainer(generations);
+        return 0;
+    }
+    if (autoplay && !load_genome(autoplay_genome)) {
+        printf("Could not load a genome from %s; run with --train first\n", genome_path);
+        return 1;
+    }
+
+    field_width = requested_width;
+    if (field_width <= 0) {
+        int cols, rows;
+        terminal_size(&cols, &rows);
+        field_width = (cols - 2) / 2;
+    }
+    if (field_width < MIN_FIELD_WIDTH) field_width = MIN_FIELD_WIDTH;
+    if (!stats_open(&stats, stats_path)) {
+        printf("Could not open %s for writing\n", stats_path);
+        return 1;
+    }
+    init_world_buffers();
+    reset_world((uint32_t) time(NULL) | 1);
+    init_snapshots();
+    atomic_init(&running, true);
     
     setup_terminal();
-    init_obstacles();
-    
-    while(true) {
-        score++;
-        update_game();
-        render_frame();
-        usleep(MICROSECONDS_PER_TICK);
-    }
+    out_init(&out, STDOUT_FILENO);
+
+    pthread_t simulation, renderer;
+    bool simulating = pthread_create(&simulation, NULL, simulation_thread, NULL) == 0;
+    bool rendering = simulating && pthread_create(&renderer, NULL, render_loop_thread, &render_loop) == 0;
+    if (!rendering) atomic_store(&running, false);
+    if (simulating) pthread_join(simulation, NULL);
+    if (rendering) pthread_join(renderer, NULL);
+    out_close(&out);
+    stats_close(&stats);
     
     cleanup_terminal();
+    if (!rendering) {
+        fprintf(stderr, "Could not start the game threads\n");
+        return 1;
+    }
+    printf(collided ? "\nCOLLISION! Game Over\n" : "\nGame Over\n");
     return 0;
 }
\ No newline at end of file
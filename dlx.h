@@ -0,0 +1,154 @@
+#ifndef DLX_H
+#define DLX_H
+
+#include <stdbool.h>
+
+// Dancing Links (Algorithm X) over a caller-owned node arena. Node 0 is the
+// root, nodes 1..column_count are column headers, and every row added after
+// that takes one node per covered column. Nothing is allocated while
+// searching, so the same arena can be rebuilt and searched any number of times.
+
+typedef struct {
+    int left, right, up, down;
+    int column;
+    int row;
+} DlxNode;
+
+typedef struct {
+    DlxNode *nodes;
+    int *sizes;
+    int *stack;
+    int node_count;
+    int node_capacity;
+    int column_count;
+    int depth;
+    int *solution;
+    int solution_length;
+} Dlx;
+
+static void dlx_init(Dlx *dlx, DlxNode *nodes, int node_capacity, int *sizes, int column_count, int *stack) {
+    dlx->nodes = nodes;
+    dlx->sizes = sizes;
+    dlx->stack = stack;
+    dlx->node_capacity = node_capacity;
+    dlx->column_count = column_count;
+    dlx->node_count = column_count + 1;
+    dlx->depth = 0;
+    dlx->solution = NULL;
+    dlx->solution_length = 0;
+
+    for (int i = 0; i <= column_count; i++) {
+        nodes[i].left = (i == 0) ? column_count : i - 1;
+        nodes[i].right = (i == column_count) ? 0 : i + 1;
+        nodes[i].up = i;
+        nodes[i].down = i;
+        nodes[i].column = i;
+        nodes[i].row = -1;
+        sizes[i] = 0;
+    }
+}
+
+// Columns are numbered from 0 by the caller and stored shifted past the root.
+static bool dlx_add_row(Dlx *dlx, int row, const int *columns, int count) {
+    if (count <= 0 || dlx->node_count + count > dlx->node_capacity) return false;
+
+    int first = dlx->node_count;
+    for (int i = 0; i < count; i++) {
+        int column = columns[i] + 1;
+        int node = dlx->node_count++;
+        DlxNode *n = &dlx->nodes[node];
+
+        n->column = column;
+        n->row = row;
+        n->down = column;
+        n->up = dlx->nodes[column].up;
+        dlx->nodes[n->up].down = node;
+        dlx->nodes[column].up = node;
+        dlx->sizes[column]++;
+
+        n->left = (i == 0) ? node : node - 1;
+        n->right = first;
+        dlx->nodes[n->left].right = node;
+        dlx->nodes[first].left = node;
+    }
+    return true;
+}
+
+static void dlx_cover(Dlx *dlx, int column) {
+    DlxNode *nodes = dlx->nodes;
+    nodes[nodes[column].right].left = nodes[column].left;
+    nodes[nodes[column].left].right = nodes[column].right;
+
+    for (int row = nodes[column].down; row != column; row = nodes[row].down) {
+        for (int node = nodes[row].right; node != row; node = nodes[node].right) {
+            nodes[nodes[node].down].up = nodes[node].up;
+            nodes[nodes[node].up].down = nodes[node].down;
+            dlx->sizes[nodes[node].column]--;
+        }
+    }
+}
+
+static void dlx_uncover(Dlx *dlx, int column) {
+    DlxNode *nodes = dlx->nodes;
+    for (int row = nodes[column].up; row != column; row = nodes[row].up) {
+        for (int node = nodes[row].left; node != row; node = nodes[node].left) {
+            dlx->sizes[nodes[node].column]++;
+            nodes[nodes[node].down].up = node;
+            nodes[nodes[node].up].down = node;
+        }
+    }
+    nodes[nodes[column].right].left = column;
+    nodes[nodes[column].left].right = column;
+}
+
+static int dlx_search_from(Dlx *dlx, int limit) {
+    DlxNode *nodes = dlx->nodes;
+    if (nodes[0].right == 0) {
+        if (dlx->solution && dlx->solution_length == 0) {
+            for (int i = 0; i < dlx->depth; i++) {
+                dlx->solution[i] = nodes[dlx->stack[i]].row;
+            }
+            dlx->solution_length = dlx->depth;
+        }
+        return 1;
+    }
+
+    int column = nodes[0].right;
+    for (int c = nodes[column].right; c != 0; c = nodes[c].right) {
+        if (dlx->sizes[c] < dlx->sizes[column]) column = c;
+    }
+    if (dlx->sizes[column] == 0) return 0;
+
+    int solutions = 0;
+    dlx_cover(dlx, column);
+    for (int row = nodes[column].down; row != column && solutions < limit; row = nodes[row].down) {
+        dlx->stack[dlx->depth++] = row;
+        for (int node = nodes[row].right; node != row; node = nodes[node].right) {
+            dlx_cover(dlx, nodes[node].column);
+        }
+
+        solutions += dlx_search_from(dlx, limit - solutions);
+
+        for (int node = nodes[row].left; node != row; node = nodes[node].left) {
+            dlx_uncover(dlx, nodes[node].column);
+        }
+        dlx->depth--;
+    }
+    dlx_uncover(dlx, column);
+    return solutions;
+}
+
+// Counts exact covers up to limit. When solution is non-NULL the row ids of
+// the first cover found are written there and the count of them is returned
+// through solution_length. The matrix is restored before returning.
+static int dlx_search(Dlx *dlx, int limit, int *solution, int *solution_length) {
+    dlx->depth = 0;
+    dlx->solution = solution;
+    dlx->solution_length = 0;
+
+    int solutions = dlx_search_from(dlx, limit);
+    if (solution_length) *solution_length = dlx->solution_length;
+    return solutions;
+}
+
+#endif
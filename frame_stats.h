@@ -0,0 +1,171 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Per-frame timing for the game loops. The caller times the input, update,
+// render-build and flush phases with stats_now_ns and hands them, with the
+// bytes and syscalls the frame cost, to stats_record once per frame drawn;
+// stats_record_frame does the arithmetic for the usual case.
+// Each measure keeps its last STATS_WINDOW samples in a ring plus a histogram
+// of the same samples, so p50 and p99 come from the histogram without sorting
+// and nothing is allocated. Buckets are eight to a power of two, so a
+// percentile is within an eighth of the true value. With a CSV file open every
+// frame is also written there as one row.
+
+#define STATS_WINDOW 512
+#define STATS_BUCKETS 256
+#define STATS_OVERLAY_LINES (STAT_COUNT + 1)
+
+enum {
+    STAT_INPUT,
+    STAT_UPDATE,
+    STAT_BUILD,
+    STAT_FLUSH,
+    STAT_BYTES,
+    STAT_SYSCALLS,
+    STAT_COUNT
+};
+
+typedef struct {
+    long samples[STATS_WINDOW];
+    int histogram[STATS_BUCKETS];
+    int next;
+    int count;
+} StatSeries;
+
+typedef struct {
+    StatSeries series[STAT_COUNT];
+    long frames;
+    long bytes_seen;
+    long syscalls_seen;
+    FILE *csv;
+} FrameStats;
+
+static const char *const stat_names[STAT_COUNT] = {
+    "input", "update", "build", "flush", "bytes", "syscalls"
+};
+
+static long long stats_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int stats_bucket(long value) {
+    if (value < 8) return value < 0 ? 0 : (int) value;
+    int exponent = 63 - __builtin_clzll((unsigned long long) value);
+    int bucket = 8 + (exponent - 3) * 8 + (int) ((value >> (exponent - 3)) & 7);
+    return bucket < STATS_BUCKETS ? bucket : STATS_BUCKETS - 1;
+}
+
+// The largest value that falls in a bucket.
+static long stats_bucket_limit(int bucket) {
+    if (bucket < 8) return bucket;
+    int shift = (bucket - 8) / 8;
+    return ((long) (8 + (bucket - 8) % 8 + 1) << shift) - 1;
+}
+
+// Starts with empty series. csv_path may be NULL; returns false only if the
+// file was asked for and could not be opened.
+static bool stats_open(FrameStats *stats, const char *csv_path) {
+    memset(stats, 0, sizeof(*stats));
+    if (!csv_path) return true;
+    stats->csv = fopen(csv_path, "w");
+    if (!stats->csv) return false;
+    fprintf(stats->csv, "frame");
+    for (int s = 0; s < STAT_COUNT; s++) {
+        fprintf(stats->csv, ",%s%s", stat_names[s], s <= STAT_FLUSH ? "_ns" : "");
+    }
+    fprintf(stats->csv, "\n");
+    return true;
+}
+
+static void stats_add(StatSeries *series, long value) {
+    if (series->count == STATS_WINDOW) {
+        series->histogram[stats_bucket(series->samples[series->next])]--;
+    } else {
+        series->count++;
+    }
+    series->samples[series->next] = value;
+    series->histogram[stats_bucket(value)]++;
+    series->next = (series->next + 1) % STATS_WINDOW;
+}
+
+static void stats_record(FrameStats *stats, const long values[STAT_COUNT]) {
+    for (int s = 0; s < STAT_COUNT; s++) stats_add(&stats->series[s], values[s]);
+    if (stats->csv) {
+        fprintf(stats->csv, "%ld", stats->frames);
+        for (int s = 0; s < STAT_COUNT; s++) fprintf(stats->csv, ",%ld", values[s]);
+        fprintf(stats->csv, "\n");
+    }
+    stats->frames++;
+}
+
+// Records a frame that was built from build_start to build_done and has just
+// been submitted. bytes and syscalls are the output's running totals; the
+// frame is charged for whatever they grew by since the last frame recorded.
+static void stats_record_frame(FrameStats *stats, long input_ns, long update_ns, long long build_start,
+    long long build_done, long bytes, long syscalls) {
+    long values[STAT_COUNT] = {
+        input_ns, update_ns, build_done - build_start, stats_now_ns() - build_done,
+        bytes - stats->bytes_seen, syscalls - stats->syscalls_seen
+    };
+    stats->bytes_seen = bytes;
+    stats->syscalls_seen = syscalls;
+    stats_record(stats, values);
+}
+
+static long stats_max(const StatSeries *series) {
+    long max = 0;
+    for (int i = 0; i < series->count; i++) {
+        if (series->samples[i] > max) max = series->samples[i];
+    }
+    return max;
+}
+
+// The value at or below which percent of the window falls, rounded up to the
+// top of its bucket but never past the largest sample.
+static long stats_percentile(const StatSeries *series, int percent) {
+    if (series->count == 0) return 0;
+    int rank = (series->count * percent + 99) / 100;
+    if (rank < 1) rank = 1;
+    int seen = 0;
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        seen += series->histogram[b];
+        if (seen >= rank) {
+            long limit = stats_bucket_limit(b);
+            long max = stats_max(series);
+            return limit < max ? limit : max;
+        }
+    }
+    return stats_max(series);
+}
+
+// One line of the overlay: a heading for line 0, then one measure per line
+// with timings shown in microseconds.
+static void stats_overlay_line(const FrameStats *stats, int line, char *buffer, size_t size) {
+    if (line == 0) {
+        snprintf(buffer, size, "Last %d frames    p50      p99      max",
+            stats->series[0].count);
+        return;
+    }
+    int s = line - 1;
+    const StatSeries *series = &stats->series[s];
+    long p50 = stats_percentile(series, 50), p99 = stats_percentile(series, 99), max = stats_max(series);
+    if (s <= STAT_FLUSH) {
+        snprintf(buffer, size, "%-9s %8.1f %8.1f %8.1f us", stat_names[s], p50 / 1e3, p99 / 1e3, max / 1e3);
+    } else {
+        snprintf(buffer, size, "%-9s %8ld %8ld %8ld", stat_names[s], p50, p99, max);
+    }
+}
+
+static void stats_close(FrameStats *stats) {
+    if (stats->csv) fclose(stats->csv);
+    stats->csv = NULL;
+}
+
+#endif
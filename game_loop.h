@@ -0,0 +1,91 @@
+#ifndef GAME_LOOP_H
+#define GAME_LOOP_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "frame_stats.h"
+#include "term_output.h"
+#include "triple_buffer.h"
+
+// What the games that simulate on one thread and draw on another share. The
+// simulation ticks on fixed deadlines with loop_wait_for_tick and publishes a
+// snapshot through a TripleBuffer; render_loop_thread draws the newest one
+// whenever the terminal has caught up with the last frame. Every snapshot type
+// starts with a FrameInfo: its sequence number lets the renderer count the
+// snapshots it never drew as dropped frames, and it carries the timings of the
+// tick that produced it so all stats are recorded on the render thread.
+
+#define LOOP_MAX_LAG_US 250000
+
+typedef struct {
+    long sequence;
+    long input_ns;
+    long update_ns;
+} FrameInfo;
+
+typedef struct {
+    TripleBuffer *snapshots;
+    TermOutput *out;
+    FrameStats *stats;
+    atomic_bool *running;
+    void (*draw)(const void *snapshot);
+} RenderLoop;
+
+// Sleeps until the next tick is due. Deadlines advance by a fixed step so
+// ticks keep their rate on average; after a long stall the clock is reset
+// rather than running a burst of catch-up ticks.
+static void loop_wait_for_tick(struct timespec *deadline, long tick_us) {
+    deadline->tv_nsec += tick_us * 1000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long remaining = (deadline->tv_sec - now.tv_sec) * 1000000LL + (deadline->tv_nsec - now.tv_nsec) / 1000;
+    if (remaining > 0) {
+        usleep((useconds_t) remaining);
+    } else if (remaining < -LOOP_MAX_LAG_US) {
+        *deadline = now;
+    }
+}
+
+// The render thread, started with a RenderLoop. Sequence numbers start at 1.
+// It exits once running is cleared and nothing fresh is left to draw, so a
+// simulation that wants its final state on screen publishes it before
+// clearing running.
+static void *render_loop_thread(void *arg) {
+    RenderLoop *loop = arg;
+    TermOutput *out = loop->out;
+    long drawn = 0;
+
+    while (true) {
+        bool stopping = !atomic_load(loop->running);
+        if (!stopping && !out_ready(out)) {
+            usleep(1000);
+            continue;
+        }
+
+        bool fresh;
+        const void *snapshot = triple_acquire(loop->snapshots, &fresh);
+        if (fresh) {
+            const FrameInfo *info = snapshot;
+            out->frames_dropped += info->sequence - drawn - 1;
+            drawn = info->sequence;
+            long long build_start = stats_now_ns();
+            loop->draw(snapshot);
+            long long build_done = stats_now_ns();
+            out_submit(out);
+            stats_record_frame(loop->stats, info->input_ns, info->update_ns, build_start, build_done,
+                out->bytes_written, out->syscalls);
+        }
+        if (stopping && !fresh) break;
+        if (!fresh) usleep(1000);
+    }
+    return NULL;
+}
+
+#endif
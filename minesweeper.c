@@ -5,42 +5,124 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "term_output.h"
+#include "frame_stats.h"
 #ifdef _WIN32
     #include <conio.h>
     #include <windows.h>
-    #define CLEAR_CMD "cls"
 #else 
     #include <termios.h>
     #include <fcntl.h>
-    #define CLEAR_CMD "clear"
+    #include <sys/ioctl.h>
 #endif
 
-#define BOARD_WIDTH 10
-#define BOARD_HEIGHT 10
+#define DEFAULT_WIDTH 10
+#define DEFAULT_HEIGHT 10
+#define MIN_BOARD_DIM 4
+#define MAX_BOARD_DIM 10000
+#define MINE_PERCENT 15
 #define TICK_RATE 60
 #define MICROSECONDS_PER_TICK (1000000 / TICK_RATE)
-#define MINES 15
-#define MAX_FLAGS MINES
+#define BITPLANE_MIN_CELLS 4096
+#define FOOTER_LINES 11
+#define CLEAR_SCREEN "\033[H\033[2J"
+
+// One byte per cell: the low nibble holds the neighbouring mine count.
+#define CELL_COUNT_MASK 0x0F
+#define CELL_MINE 0x10
+#define CELL_CLICKED 0x20
+#define CELL_FLAGGED 0x40
+
+#define ODDS_NONE 101
+#define ODDS_SAFE 102
+#define ODDS_MINE 103
+#define MARK_ODDS 0x7F
+#define MARK_QUEUED 0x80
+#define SOLVER_MAX_EXACT_CELLS 48
+#define SOLVER_NODE_BUDGET 400000
+#define SOLVER_SAMPLES 256
+#define SOLVER_SAMPLE_BUDGET 2000000
+#define SOLVER_EXACT_COMPONENTS 24
+#define SOLVER_EXACT_FRONTIER 512
+#define SOLVER_PARALLEL_MIN 64
+#define SOLVER_MAX_THREADS 8
+#define PREGEN_LAYOUTS 3
+#define URGENT_LAYOUT PREGEN_LAYOUTS
+#define LAYOUT_EMPTY 0
+#define LAYOUT_FILLING 1
+#define LAYOUT_READY 2
+#define NO_GUESS_TIMEOUT_MS 10000
+#define NO_GUESS_NOTICE_MS 200
 
 typedef struct {
     int x, y;
 } Position;
 
-typedef struct {
-    Position pos;
-    bool flagged;
-    bool clicked; 
-    bool mine;
-    int close; 
-} Square;
-
-Square board[BOARD_HEIGHT][BOARD_WIDTH];
-Position player_pos = {BOARD_WIDTH / 2, BOARD_HEIGHT / 2};
-Position last_player_pos = {-1, -1}; 
+int board_width = DEFAULT_WIDTH;
+int board_height = DEFAULT_HEIGHT;
+int mine_count = DEFAULT_WIDTH * DEFAULT_HEIGHT * MINE_PERCENT / 100;
+uint8_t *board = NULL;
+Position player_pos = {DEFAULT_WIDTH / 2, DEFAULT_HEIGHT / 2};
+Position view_origin = {0, 0};
 bool board_changed = true; 
 bool mines_planted = false;
 bool loss = false; 
 int flags_placed = 0;
+int safe_remaining = 0;
+uint32_t mine_seed = 1;
+static TermOutput out;
+static FrameStats stats;
+static bool stats_visible = false;
+
+typedef struct {
+    int *items;
+    size_t count;
+    size_t capacity;
+} IntList;
+
+// Solver knowledge lives beside the board in one byte per cell: the low seven
+// bits hold a mine percentage or one of the ODDS_ codes, and the top bit marks
+// a clue already waiting on the dirty list.
+typedef struct {
+    uint8_t *cells;
+    uint8_t *marks;
+    int width, height, mines;
+    int known_mines;
+    int revealed_count;
+    int interior_odds;
+    IntList revealed;
+    IntList dirty;
+    IntList clues;
+    IntList safe;
+    IntList found_mines;
+} Solver;
+
+// Layouts proven solvable without guessing. Slots cycle EMPTY -> FILLING ->
+// READY -> EMPTY; the worker that wins the FILLING exchange owns the copy.
+typedef struct {
+    uint8_t *cells;
+    int start;
+    atomic_int state;
+} LayoutSlot;
+
+IntList reveal_queue;
+Solver game_solver;
+LayoutSlot layout_slots[PREGEN_LAYOUTS + 1];
+atomic_int urgent_start;
+atomic_int pregen_start;
+atomic_bool layout_stop;
+pthread_t layout_threads[SOLVER_MAX_THREADS];
+int layout_thread_count = 0;
+bool no_guess = false;
+bool no_guess_layout = false;
+bool autoplay = false;
+bool show_odds = false;
+long solver_moves = 0;
+double solver_last_ms = 0;
+double solver_total_ms = 0;
+double solver_max_ms = 0;
 
 #ifndef _WIN32
 static struct termios original_termios;
@@ -94,99 +176,1231 @@ static char read_char() {
 }
 #endif
 
-static void plant_mines(int safeX, int safeY){ 
-    int placed = 0;
-    while (placed < MINES) {
-        int x = rand() % BOARD_WIDTH;
-        int y = rand() % BOARD_HEIGHT;
-        if (abs(x - safeX) <= 1 && abs(y - safeY) <= 1) continue;
-        if (!board[y][x].mine) {
-            board[y][x].mine = true; 
-            placed++;
+static inline uint8_t *cell_at(int x, int y) {
+    return &board[(size_t) y * board_width + x];
+}
+
+static void *solver_alloc(size_t size) {
+    void *memory = calloc(1, size);
+    if (!memory) {
+        cleanup_terminal();
+        fprintf(stderr, "Out of memory in solver\n");
+        exit(1);
+    }
+    return memory;
+}
+
+static void list_push(IntList *list, int value) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        int *grown = realloc(list->items, capacity * sizeof(int));
+        if (!grown) {
+            cleanup_terminal();
+            fprintf(stderr, "Out of memory in solver\n");
+            exit(1);
         }
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = value;
+}
+
+static void init_board() {
+    board = calloc((size_t) board_width * board_height, 1);
+    if (!board) {
+        fprintf(stderr, "Not enough memory for a %dx%d board\n", board_width, board_height);
+        exit(1);
+    }
+}
+
+static void count_direct(uint8_t *cells, int width, int height) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (!(cells[y * width + x] & CELL_MINE)) continue;
+            for (int dy = y - 1; dy <= y + 1; dy++) {
+                for (int dx = x - 1; dx <= x + 1; dx++) {
+                    if (dy < 0 || dy >= height || dx < 0 || dx >= width) continue;
+                    if (dy == y && dx == x) continue;
+                    cells[dy * width + dx]++;
+                }
+            }
+        }
+    }
+}
+
+static void load_mine_row(const uint8_t *cells, int width, int height, uint64_t *words, int y) {
+    int row_words = (width + 63) / 64;
+    memset(words, 0, row_words * sizeof(uint64_t));
+    if (y < 0 || y >= height) return;
+    const uint8_t *row = &cells[(size_t) y * width];
+    for (int x = 0; x < width; x++) {
+        if (row[x] & CELL_MINE) words[x / 64] |= 1ULL << (x % 64);
+    }
+}
+
+// Counts 64 cells at a time: the mine bitmap rows above, on and below are
+// shifted one column each way into eight one-bit planes, which a bit-sliced
+// ripple counter sums into four count bits per cell. Only three bitmap rows
+// are live at once.
+static void count_bitplanes(uint8_t *cells, int width, int height) {
+    int row_words = (width + 63) / 64;
+    uint64_t *mine_rows = solver_alloc((size_t) row_words * 3 * sizeof(uint64_t));
+    uint64_t *above = mine_rows;
+    uint64_t *current = mine_rows + row_words;
+    uint64_t *below = mine_rows + 2 * row_words;
+    load_mine_row(cells, width, height, above, -1);
+    load_mine_row(cells, width, height, current, 0);
+
+    for (int y = 0; y < height; y++) {
+        load_mine_row(cells, width, height, below, y + 1);
+        uint64_t *rows[3] = {above, current, below};
+        uint8_t *out = &cells[(size_t) y * width];
+
+        for (int w = 0; w < row_words; w++) {
+            uint64_t planes[8];
+            int plane_count = 0;
+
+            for (int r = 0; r < 3; r++) {
+                uint64_t mid = rows[r][w];
+                uint64_t lower = (w > 0) ? rows[r][w - 1] >> 63 : 0;
+                uint64_t upper = (w < row_words - 1) ? rows[r][w + 1] << 63 : 0;
+                planes[plane_count++] = (mid << 1) | lower;
+                planes[plane_count++] = (mid >> 1) | upper;
+                if (r != 1) planes[plane_count++] = mid;
+            }
+
+            uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+            for (int i = 0; i < plane_count; i++) {
+                uint64_t carry0 = c0 & planes[i];
+                c0 ^= planes[i];
+                uint64_t carry1 = c1 & carry0;
+                c1 ^= carry0;
+                uint64_t carry2 = c2 & carry1;
+                c2 ^= carry1;
+                c3 |= carry2;
+            }
+
+            for (int bit = 0; bit < 64 && w * 64 + bit < width; bit++) {
+                uint8_t count = ((c0 >> bit) & 1) | ((c1 >> bit) & 1) << 1 |
+                    ((c2 >> bit) & 1) << 2 | ((c3 >> bit) & 1) << 3;
+                out[w * 64 + bit] = (out[w * 64 + bit] & ~CELL_COUNT_MASK) | count;
+            }
+        }
+
+        uint64_t *recycled = above;
+        above = current;
+        current = below;
+        below = recycled;
+    }
+    free(mine_rows);
+}
+
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Maps the k-th cell outside the safe zone to its board index. The excluded
+// indices are in ascending order, so each one at or below the running index
+// pushes it one further along.
+static int candidate_cell(int k, const int *excluded, int excluded_count) {
+    for (int i = 0; i < excluded_count; i++) {
+        if (k >= excluded[i]) k++;
     }
+    return k;
 }
 
-static int get_near(int x, int y) {
-    int count = 0;
+// Lays mines on an empty board outside the 3x3 zone around the first click
+// and fills in the neighbour counts.
+static void place_mines(uint8_t *cells, int width, int height, int mines, int safeX, int safeY, uint32_t *seed) {
+    int excluded[9];
+    int excluded_count = 0;
+    for (int y = safeY - 1; y <= safeY + 1; y++) {
+        for (int x = safeX - 1; x <= safeX + 1; x++) {
+            if (y < 0 || y >= height || x < 0 || x >= width) continue;
+            excluded[excluded_count++] = y * width + x;
+        }
+    }
+
+    // Floyd's form of a partial Fisher-Yates shuffle over the cells outside
+    // the safe zone: each step takes one cell, and the board's own mine bit
+    // stands in for the swap array. Past half density the free cells are
+    // drawn instead, so the random draws never exceed the mine count.
+    int candidates = width * height - excluded_count;
+    bool draw_free = mines > candidates / 2;
+    int draws = draw_free ? candidates - mines : mines;
+    for (int j = candidates - draws; j < candidates; j++) {
+        int pick = next_random(seed) % (uint32_t) (j + 1);
+        int index = candidate_cell(pick, excluded, excluded_count);
+        if (cells[index] & CELL_MINE) index = candidate_cell(j, excluded, excluded_count);
+        cells[index] |= CELL_MINE;
+    }
+
+    if (draw_free) {
+        for (int i = 0; i < width * height; i++) {
+            cells[i] ^= CELL_MINE;
+        }
+        for (int i = 0; i < excluded_count; i++) {
+            cells[excluded[i]] &= ~CELL_MINE;
+        }
+    }
+
+    if ((long long) width * height >= BITPLANE_MIN_CELLS) {
+        count_bitplanes(cells, width, height);
+    } else {
+        count_direct(cells, width, height);
+    }
+}
+
+// Reveals a safe cell and, when it borders no mines, the whole opening around
+// it, leaving flagged cells covered. The queue only ever holds the frontier
+// of the fill: its consumed front is dropped before it is allowed to grow.
+// Every revealed cell is appended to log when one is given. Returns the
+// number of cells revealed.
+static int flood_reveal(uint8_t *cells, int width, int height, int start, IntList *queue, IntList *log) {
+    cells[start] |= CELL_CLICKED;
+    if (log) list_push(log, start);
+    if (cells[start] & CELL_COUNT_MASK) return 1;
+
+    int revealed = 1;
+    size_t head = 0;
+    queue->count = 0;
+    list_push(queue, start);
+
+    while (head < queue->count) {
+        int px = queue->items[head] % width;
+        int py = queue->items[head] / width;
+        head++;
+        for (int dy = py - 1; dy <= py + 1; dy++) {
+            for (int dx = px - 1; dx <= px + 1; dx++) {
+                if (dy < 0 || dy >= height || dx < 0 || dx >= width) continue;
+                int next = dy * width + dx;
+                if (cells[next] & (CELL_CLICKED | CELL_FLAGGED)) continue;
+
+                cells[next] |= CELL_CLICKED;
+                revealed++;
+                if (log) list_push(log, next);
+                if ((cells[next] & CELL_COUNT_MASK) == 0) {
+                    if (queue->count == queue->capacity && head > queue->capacity / 2) {
+                        memmove(queue->items, queue->items + head, (queue->count - head) * sizeof(int));
+                        queue->count -= head;
+                        head = 0;
+                    }
+                    list_push(queue, next);
+                }
+            }
+        }
+    }
+    return revealed;
+}
+
+static void solver_reset(Solver *s) {
+    memset(s->marks, ODDS_NONE, (size_t) s->width * s->height);
+    s->known_mines = 0;
+    s->revealed_count = 0;
+    s->interior_odds = ODDS_NONE;
+    s->revealed.count = 0;
+    s->dirty.count = 0;
+    s->clues.count = 0;
+    s->safe.count = 0;
+    s->found_mines.count = 0;
+}
+
+static void solver_init(Solver *s, uint8_t *cells, int width, int height, int mines) {
+    s->cells = cells;
+    s->width = width;
+    s->height = height;
+    s->mines = mines;
+    if (!s->marks) s->marks = solver_alloc((size_t) width * height);
+    solver_reset(s);
+}
+
+static inline int get_odds(const Solver *s, int index) {
+    return s->marks[index] & MARK_ODDS;
+}
+
+static inline void set_odds(Solver *s, int index, int odds) {
+    s->marks[index] = (s->marks[index] & MARK_QUEUED) | odds;
+}
+
+static inline bool is_clue(const Solver *s, int index) {
+    return (s->cells[index] & CELL_CLICKED) && (s->cells[index] & CELL_COUNT_MASK);
+}
+
+static void solver_queue(Solver *s, int index) {
+    if (!is_clue(s, index) || (s->marks[index] & MARK_QUEUED)) return;
+    s->marks[index] |= MARK_QUEUED;
+    list_push(&s->dirty, index);
+}
+
+static void solver_queue_around(Solver *s, int index) {
+    int x = index % s->width, y = index / s->width;
     for (int dy = y - 1; dy <= y + 1; dy++) {
         for (int dx = x - 1; dx <= x + 1; dx++) {
-            if (dy < 0 || dy >= BOARD_HEIGHT || dx < 0 || dx >= BOARD_WIDTH) continue;
-            if (dy == y && dx == x) continue;
+            if (dy < 0 || dy >= s->height || dx < 0 || dx >= s->width) continue;
+            solver_queue(s, dy * s->width + dx);
+        }
+    }
+}
+
+static void solver_mark_mine(Solver *s, int index) {
+    if (get_odds(s, index) == ODDS_MINE) return;
+    set_odds(s, index, ODDS_MINE);
+    s->known_mines++;
+    list_push(&s->found_mines, index);
+    solver_queue_around(s, index);
+}
+
+static void solver_mark_safe(Solver *s, int index) {
+    int odds = get_odds(s, index);
+    if (odds == ODDS_SAFE || odds == ODDS_MINE || (s->cells[index] & CELL_CLICKED)) return;
+    set_odds(s, index, ODDS_SAFE);
+    list_push(&s->safe, index);
+    solver_queue_around(s, index);
+}
+
+// Collects the undecided neighbours of a clue and returns how many of its
+// mines are still unaccounted for among them.
+static int clue_unknowns(const Solver *s, int index, int *unknown, int *unknown_count) {
+    int x = index % s->width, y = index / s->width;
+    int remaining = s->cells[index] & CELL_COUNT_MASK;
+    *unknown_count = 0;
+
+    for (int dy = y - 1; dy <= y + 1; dy++) {
+        for (int dx = x - 1; dx <= x + 1; dx++) {
+            if (dy < 0 || dy >= s->height || dx < 0 || dx >= s->width) continue;
+            int neighbor = dy * s->width + dx;
+            if (s->cells[neighbor] & CELL_CLICKED) continue;
+            int odds = get_odds(s, neighbor);
+            if (odds == ODDS_MINE) {
+                remaining--;
+            } else if (odds != ODDS_SAFE) {
+                unknown[(*unknown_count)++] = neighbor;
+            }
+        }
+    }
+    return remaining;
+}
+
+// Cells revealed since the last pass become clues and wake the clues around them.
+static void solver_absorb(Solver *s) {
+    for (size_t i = 0; i < s->revealed.count; i++) {
+        int index = s->revealed.items[i];
+        s->revealed_count++;
+        if (s->cells[index] & CELL_COUNT_MASK) list_push(&s->clues, index);
+        solver_queue_around(s, index);
+    }
+    s->revealed.count = 0;
+}
+
+// If every unknown of the smaller clue also borders the larger one, the
+// difference between the two holds exactly the difference in their mines.
+static void apply_subset(Solver *s, const int *small, int small_count, int small_mines,
+                         const int *large, int large_count, int large_mines) {
+    int rest[8];
+    int rest_count = 0;
+    int shared = 0;
+
+    for (int i = 0; i < large_count; i++) {
+        bool found = false;
+        for (int j = 0; j < small_count; j++) {
+            if (large[i] == small[j]) found = true;
+        }
+        if (found) {
+            shared++;
+        } else {
+            rest[rest_count++] = large[i];
+        }
+    }
+    if (shared != small_count || rest_count == 0) return;
+
+    int rest_mines = large_mines - small_mines;
+    for (int i = 0; i < rest_count; i++) {
+        if (rest_mines == 0) {
+            solver_mark_safe(s, rest[i]);
+        } else if (rest_mines == rest_count) {
+            solver_mark_mine(s, rest[i]);
+        }
+    }
+}
+
+// Applies the single-clue rule, then the subset rule against every clue at
+// most two cells away, until the dirty list drains. Only clues whose
+// neighbourhood changed are revisited, so each pass costs what the last move
+// touched rather than the whole frontier.
+static void solver_deduce(Solver *s) {
+    solver_absorb(s);
+
+    while (s->dirty.count > 0) {
+        int a = s->dirty.items[--s->dirty.count];
+        s->marks[a] &= ~MARK_QUEUED;
+
+        int a_cells[8], a_count;
+        int a_mines = clue_unknowns(s, a, a_cells, &a_count);
+        if (a_count == 0) continue;
+
+        if (a_mines == 0 || a_mines == a_count) {
+            for (int i = 0; i < a_count; i++) {
+                if (a_mines == 0) {
+                    solver_mark_safe(s, a_cells[i]);
+                } else {
+                    solver_mark_mine(s, a_cells[i]);
+                }
+            }
+            continue;
+        }
+
+        int ax = a % s->width, ay = a / s->width;
+        for (int by = ay - 2; by <= ay + 2; by++) {
+            for (int bx = ax - 2; bx <= ax + 2; bx++) {
+                if (by < 0 || by >= s->height || bx < 0 || bx >= s->width) continue;
+                int b = by * s->width + bx;
+                if (b == a || !is_clue(s, b)) continue;
+
+                int b_cells[8], b_count;
+                int b_mines = clue_unknowns(s, b, b_cells, &b_count);
+                if (b_count == 0) continue;
+                apply_subset(s, a_cells, a_count, a_mines, b_cells, b_count, b_mines);
+                apply_subset(s, b_cells, b_count, b_mines, a_cells, a_count, a_mines);
+            }
+        }
+    }
+}
+
+typedef struct {
+    int cells[8];
+    int cell_count;
+    int mines;
+    int assigned;
+    int open;
+} Constraint;
+
+typedef struct {
+    int board_index;
+    int clues[8];
+    int clue_count;
+} FrontierCell;
+
+// Exact components count solutions by mine total: solutions[k] and
+// cell_mines[cell * (n + 1) + k]. Sampled components only keep the number of
+// samples in solutions[0] and a per-cell mine tally.
+typedef struct {
+    int *cells;
+    int cell_count;
+    bool sampled;
+    double *solutions;
+    double *cell_mines;
+    uint32_t seed;
+} Component;
+
+typedef struct {
+    Constraint *clues;
+    int clue_count;
+    FrontierCell *cells;
+    int cell_count;
+    int *order;
+    uint8_t *assignment;
+    uint8_t *tries;
+    double *odds;
+    Component *components;
+    int component_count;
+    atomic_int next_component;
+} Frontier;
+
+static bool assign_cell(Frontier *f, int id, int value) {
+    FrontierCell *cell = &f->cells[id];
+    bool feasible = true;
+    f->assignment[id] = value;
+    for (int i = 0; i < cell->clue_count; i++) {
+        Constraint *clue = &f->clues[cell->clues[i]];
+        clue->assigned += value;
+        clue->open--;
+        if (clue->assigned > clue->mines || clue->assigned + clue->open < clue->mines) feasible = false;
+    }
+    return feasible;
+}
+
+static void unassign_cell(Frontier *f, int id) {
+    FrontierCell *cell = &f->cells[id];
+    for (int i = 0; i < cell->clue_count; i++) {
+        Constraint *clue = &f->clues[cell->clues[i]];
+        clue->assigned -= f->assignment[id];
+        clue->open++;
+    }
+}
+
+// Iterative depth-first search over one component, so large frontiers cannot
+// overflow a worker's stack. An exact search visits every consistent
+// assignment; a sampling search tries values in random order and stops at
+// the first one. Returns false if the node budget ran out first.
+static bool search_component(Frontier *f, Component *c, long *budget) {
+    int n = c->cell_count;
+    int depth = 0, mines = 0;
+    f->tries[c->cells[0]] = 0;
+
+    while (depth >= 0) {
+        if (depth == n) {
+            if (c->sampled) {
+                c->solutions[0] += 1;
+                for (int i = 0; i < n; i++) c->cell_mines[i] += f->assignment[c->cells[i]];
+                for (int i = n - 1; i >= 0; i--) unassign_cell(f, c->cells[i]);
+                return true;
+            }
+            c->solutions[mines] += 1;
+            for (int i = 0; i < n; i++) {
+                if (f->assignment[c->cells[i]]) c->cell_mines[i * (n + 1) + mines] += 1;
+            }
+            depth--;
+            continue;
+        }
+
+        int id = c->cells[depth];
+        if (f->tries[id] > 0) {
+            unassign_cell(f, id);
+            mines -= f->assignment[id];
+        }
+        if (f->tries[id] == 2) {
+            depth--;
+            continue;
+        }
+        if (--*budget < 0) {
+            for (int i = depth - 1; i >= 0; i--) unassign_cell(f, c->cells[i]);
+            return false;
+        }
+
+        int value;
+        if (f->tries[id] == 0) {
+            value = c->sampled ? (int) (next_random(&c->seed) & 1) : 0;
+        } else {
+            value = !f->assignment[id];
+        }
+        f->tries[id]++;
+        mines += value;
+        if (assign_cell(f, id, value)) {
+            depth++;
+            if (depth < n) f->tries[c->cells[depth]] = 0;
+        }
+    }
+    return true;
+}
+
+static void solve_component(Frontier *f, Component *c) {
+    int n = c->cell_count;
+
+    if (n <= SOLVER_MAX_EXACT_CELLS) {
+        long budget = SOLVER_NODE_BUDGET;
+        c->solutions = solver_alloc((size_t) (n + 1) * (n + 1) * sizeof(double));
+        c->cell_mines = c->solutions + n + 1;
+        if (search_component(f, c, &budget)) return;
+        free(c->solutions);
+    }
+
+    // Too large to enumerate in time: fall back to randomised samples.
+    c->sampled = true;
+    c->solutions = solver_alloc((size_t) (n + 1) * sizeof(double));
+    c->cell_mines = c->solutions + 1;
+    long budget = SOLVER_SAMPLE_BUDGET;
+    for (int i = 0; i < SOLVER_SAMPLES && budget > 0; i++) {
+        search_component(f, c, &budget);
+    }
+}
+
+static void *component_worker(void *arg) {
+    Frontier *f = arg;
+    int index;
+    while ((index = atomic_fetch_add(&f->next_component, 1)) < f->component_count) {
+        solve_component(f, &f->components[index]);
+    }
+    return NULL;
+}
+
+static int solver_thread_count() {
+#ifndef _WIN32
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    long count = 4;
+#endif
+    if (count < 1) count = 1;
+    if (count > SOLVER_MAX_THREADS) count = SOLVER_MAX_THREADS;
+    return (int) count;
+}
+
+static int frontier_lookup(const int *keys, const int *values, int mask, int key) {
+    for (int slot = (key * 2654435761u) & mask; keys[slot] != -1; slot = (slot + 1) & mask) {
+        if (keys[slot] == key) return values[slot];
+    }
+    return -1;
+}
+
+// Turns every clue that still borders undecided cells into a constraint and
+// splits the cells they touch into independent components, each listed in
+// breadth-first order so neighbouring cells are assigned close together.
+static void build_frontier(Solver *s, Frontier *f) {
+    size_t kept = 0;
+    for (size_t i = 0; i < s->clues.count; i++) {
+        int unknown[8], unknown_count;
+        clue_unknowns(s, s->clues.items[i], unknown, &unknown_count);
+        if (unknown_count > 0) s->clues.items[kept++] = s->clues.items[i];
+    }
+    s->clues.count = kept;
+
+    f->clues = solver_alloc((kept + 1) * sizeof(Constraint));
+    f->cells = solver_alloc((kept * 8 + 1) * sizeof(FrontierCell));
+    int mask = 1;
+    while (mask < (int) kept * 16) mask <<= 1;
+    int *keys = solver_alloc(mask * sizeof(int));
+    int *values = solver_alloc(mask * sizeof(int));
+    memset(keys, -1, mask * sizeof(int));
+    mask--;
+
+    for (size_t i = 0; i < kept; i++) {
+        Constraint *clue = &f->clues[f->clue_count];
+        int unknown[8], unknown_count;
+        clue->mines = clue_unknowns(s, s->clues.items[i], unknown, &unknown_count);
+        clue->cell_count = unknown_count;
+        clue->open = unknown_count;
+
+        for (int u = 0; u < unknown_count; u++) {
+            int id = frontier_lookup(keys, values, mask, unknown[u]);
+            if (id < 0) {
+                id = f->cell_count++;
+                f->cells[id].board_index = unknown[u];
+                int slot = (unknown[u] * 2654435761u) & mask;
+                while (keys[slot] != -1) slot = (slot + 1) & mask;
+                keys[slot] = unknown[u];
+                values[slot] = id;
+            }
+            clue->cells[u] = id;
+            f->cells[id].clues[f->cells[id].clue_count++] = f->clue_count;
+        }
+        f->clue_count++;
+    }
+    free(keys);
+    free(values);
+
+    f->order = solver_alloc((f->cell_count + 1) * sizeof(int));
+    f->assignment = solver_alloc(f->cell_count + 1);
+    f->tries = solver_alloc(f->cell_count + 1);
+    f->odds = solver_alloc((f->cell_count + 1) * sizeof(double));
+    f->components = solver_alloc((f->cell_count + 1) * sizeof(Component));
+    // The search resets tries before using it, so it doubles as the visited mark.
+    uint8_t *seen = f->tries;
+
+    int tail = 0;
+    for (int start = 0; start < f->cell_count; start++) {
+        if (seen[start]) continue;
+        Component *c = &f->components[f->component_count++];
+        c->cells = &f->order[tail];
+        c->seed = (uint32_t) start * 2654435761u | 1;
+        seen[start] = 1;
+        f->order[tail++] = start;
+
+        for (int head = c->cells - f->order; head < tail; head++) {
+            FrontierCell *cell = &f->cells[f->order[head]];
+            for (int i = 0; i < cell->clue_count; i++) {
+                Constraint *clue = &f->clues[cell->clues[i]];
+                for (int j = 0; j < clue->cell_count; j++) {
+                    if (seen[clue->cells[j]]) continue;
+                    seen[clue->cells[j]] = 1;
+                    f->order[tail++] = clue->cells[j];
+                }
+            }
+        }
+        c->cell_count = &f->order[tail] - c->cells;
+    }
+}
+
+static void free_frontier(Frontier *f) {
+    for (int i = 0; i < f->component_count; i++) free(f->components[i].solutions);
+    free(f->clues);
+    free(f->cells);
+    free(f->order);
+    free(f->assignment);
+    free(f->tries);
+    free(f->odds);
+    free(f->components);
+}
+
+static void convolve(const long double *a, int a_length, const long double *b, int b_length, long double *out) {
+    long double largest = 0;
+    for (int i = 0; i < a_length + b_length - 1; i++) out[i] = 0;
+    for (int i = 0; i < a_length; i++) {
+        if (a[i] == 0) continue;
+        for (int j = 0; j < b_length; j++) out[i + j] += a[i] * b[j];
+    }
+    for (int i = 0; i < a_length + b_length - 1; i++) {
+        if (out[i] > largest) largest = out[i];
+    }
+    if (largest > 0) {
+        for (int i = 0; i < a_length + b_length - 1; i++) out[i] /= largest;
+    }
+}
+
+// Exact combination: how likely each frontier mine total is depends on how
+// many ways the rest of the mines fit in the interior, C(interior, mines - K).
+// Each component is weighted by the convolution of every other component's
+// mine-count distribution. Returns the expected number of interior mines.
+static double combine_exact(Frontier *f, int mines, int interior) {
+    int total = f->cell_count;
+    int count = f->component_count;
+    long double *weight = solver_alloc((total + 1) * sizeof(long double));
+    long double *prefix = solver_alloc((size_t) (count + 1) * (total + 1) * sizeof(long double));
+    long double *suffix = solver_alloc((size_t) (count + 2) * (total + 1) * sizeof(long double));
+    long double *others = solver_alloc((total + 1) * sizeof(long double));
+    long double *dist = solver_alloc((total + 1) * sizeof(long double));
+    int *lengths = solver_alloc((count + 2) * sizeof(int));
+
+    int low = mines - interior > 0 ? mines - interior : 0;
+    int high = mines < total ? mines : total;
+    if (low <= high) weight[low] = 1;
+    for (int k = low; k < high; k++) {
+        weight[k + 1] = weight[k] * (mines - k) / (interior - mines + k + 1);
+        if (weight[k + 1] > 1e250L) {
+            for (int j = low; j <= k + 1; j++) weight[j] /= 1e250L;
+        }
+    }
+
+    prefix[0] = 1;
+    lengths[0] = 1;
+    for (int c = 0; c < count; c++) {
+        Component *component = &f->components[c];
+        for (int k = 0; k <= component->cell_count; k++) dist[k] = component->solutions[k];
+        convolve(&prefix[(size_t) c * (total + 1)], lengths[c], dist, component->cell_count + 1, &prefix[(size_t) (c + 1) * (total + 1)]);
+        lengths[c + 1] = lengths[c] + component->cell_count;
+    }
+    int suffix_length = 1;
+    suffix[(size_t) count * (total + 1)] = 1;
+    for (int c = count - 1; c >= 0; c--) {
+        Component *component = &f->components[c];
+        for (int k = 0; k <= component->cell_count; k++) dist[k] = component->solutions[k];
+        convolve(&suffix[(size_t) (c + 1) * (total + 1)], suffix_length, dist, component->cell_count + 1, &suffix[(size_t) c * (total + 1)]);
+        suffix_length += component->cell_count;
+    }
+
+    suffix_length = 1;
+    for (int c = count - 1; c >= 0; c--) {
+        Component *component = &f->components[c];
+        int n = component->cell_count;
+        convolve(&prefix[(size_t) c * (total + 1)], lengths[c], &suffix[(size_t) (c + 1) * (total + 1)], suffix_length, others);
+        int others_length = lengths[c] + suffix_length - 1;
+
+        for (int k = 0; k <= n; k++) {
+            dist[k] = 0;
+            for (int j = 0; j < others_length && k + j <= total; j++) dist[k] += others[j] * weight[k + j];
+        }
+        long double denominator = 0;
+        for (int k = 0; k <= n; k++) denominator += component->solutions[k] * dist[k];
+        for (int i = 0; i < n; i++) {
+            long double numerator = 0;
+            for (int k = 0; k <= n; k++) numerator += component->cell_mines[i * (n + 1) + k] * dist[k];
+            f->odds[component->cells[i]] = denominator > 0 ? (double) (numerator / denominator) : 0.5;
+        }
+        suffix_length += n;
+    }
+
+    long double expected = 0, norm = 0;
+    long double *all = &prefix[(size_t) count * (total + 1)];
+    for (int k = 0; k <= total; k++) {
+        expected += all[k] * weight[k] * (mines - k);
+        norm += all[k] * weight[k];
+    }
+
+    free(weight);
+    free(prefix);
+    free(suffix);
+    free(others);
+    free(dist);
+    free(lengths);
+    return norm > 0 ? (double) (expected / norm) : 0;
+}
+
+// With many components the interior is large, so adding one frontier mine
+// scales the interior's share by a near-constant factor q = p / (1 - p).
+// Components are weighted by q^k independently and p is refined from the
+// expected frontier total a few times. Returns the expected interior mines.
+static double combine_density(Frontier *f, int mines, int unknown, int interior) {
+    double density = unknown > 0 ? (double) mines / unknown : 0;
+
+    for (int round = 0; round < 4; round++) {
+        double q = density >= 1 ? 1e9 : density / (1 - density);
+        if (q < 1e-9) q = 1e-9;
+        if (q > 1e9) q = 1e9;
+        double frontier_mines = 0;
+
+        for (int c = 0; c < f->component_count; c++) {
+            Component *component = &f->components[c];
+            int n = component->cell_count;
+
+            if (component->sampled) {
+                for (int i = 0; i < n; i++) {
+                    double odds = component->solutions[0] > 0 ? component->cell_mines[i] / component->solutions[0] : density;
+                    f->odds[component->cells[i]] = odds;
+                    frontier_mines += odds;
+                }
+                continue;
+            }
+
+            long double power = 1, denominator = 0;
+            for (int k = 0; k <= n; k++) {
+                denominator += component->solutions[k] * power;
+                power *= q;
+            }
+            for (int i = 0; i < n; i++) {
+                long double numerator = 0;
+                power = 1;
+                for (int k = 0; k <= n; k++) {
+                    numerator += component->cell_mines[i * (n + 1) + k] * power;
+                    power *= q;
+                }
+                double odds = denominator > 0 ? (double) (numerator / denominator) : density;
+                f->odds[component->cells[i]] = odds;
+                frontier_mines += odds;
+            }
+        }
+
+        if (interior <= 0) return 0;
+        density = (mines - frontier_mines) / interior;
+        if (density < 0) density = 0;
+        if (density > 1) density = 1;
+    }
+    return density * interior;
+}
+
+static int interior_cell(Solver *s) {
+    int cells = s->width * s->height;
+    uint32_t seed = (uint32_t) (s->revealed_count * 2654435761u) | 1;
+    for (int probe = 0; probe < 64; probe++) {
+        int index = next_random(&seed) % (uint32_t) cells;
+        if (!(s->cells[index] & CELL_CLICKED) && get_odds(s, index) == ODDS_NONE) return index;
+    }
+    int start = next_random(&seed) % (uint32_t) cells;
+    for (int i = 0; i < cells; i++) {
+        int index = (start + i) % cells;
+        if (!(s->cells[index] & CELL_CLICKED) && get_odds(s, index) == ODDS_NONE) return index;
+    }
+    return -1;
+}
+
+// Computes a mine probability for every frontier cell and the interior, marks
+// cells the enumeration proves safe or mined, and returns the undecided cell
+// least likely to be a mine, or -1 if nothing is left to click.
+static int solver_probabilities(Solver *s) {
+    Frontier f;
+    memset(&f, 0, sizeof(f));
+    build_frontier(s, &f);
+
+    // Components are independent, so helpers claim them off a shared counter
+    // while this thread works through the same queue.
+    pthread_t threads[SOLVER_MAX_THREADS];
+    int started = 0;
+    atomic_init(&f.next_component, 0);
+    if (f.cell_count >= SOLVER_PARALLEL_MIN) {
+        int helpers = solver_thread_count() - 1;
+        if (helpers > f.component_count - 1) helpers = f.component_count - 1;
+        while (started < helpers && pthread_create(&threads[started], NULL, component_worker, &f) == 0) started++;
+    }
+    component_worker(&f);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+
+    int pending_safe = 0;
+    for (size_t i = 0; i < s->safe.count; i++) {
+        if (!(s->cells[s->safe.items[i]] & CELL_CLICKED)) pending_safe++;
+    }
+    int mines = s->mines - s->known_mines;
+    int unknown = s->width * s->height - s->revealed_count - s->known_mines - pending_safe;
+    int interior = unknown - f.cell_count;
+
+    bool exact = f.component_count <= SOLVER_EXACT_COMPONENTS && f.cell_count <= SOLVER_EXACT_FRONTIER;
+    for (int c = 0; c < f.component_count; c++) {
+        if (f.components[c].sampled) exact = false;
+    }
+    double interior_mines = exact ? combine_exact(&f, mines, interior) : combine_density(&f, mines, unknown, interior);
+    double interior_odds = interior > 0 ? interior_mines / interior : 1;
+
+    int best = -1;
+    double best_odds = 2;
+    for (int c = 0; c < f.component_count; c++) {
+        Component *component = &f.components[c];
+        for (int i = 0; i < component->cell_count; i++) {
+            int index = f.cells[component->cells[i]].board_index;
+            double odds = f.odds[component->cells[i]];
+            if (!component->sampled && odds <= 0) {
+                solver_mark_safe(s, index);
+            } else if (!component->sampled && odds >= 1) {
+                solver_mark_mine(s, index);
+            } else {
+                set_odds(s, index, (int) (odds * 100 + 0.5));
+                if (odds < best_odds) {
+                    best_odds = odds;
+                    best = index;
+                }
+            }
+        }
+    }
+    s->interior_odds = (int) (interior_odds * 100 + 0.5);
+    if (interior > 0 && interior_odds < best_odds) {
+        int index = interior_cell(s);
+        if (index >= 0) best = index;
+    }
+
+    free_frontier(&f);
+    return best;
+}
+
+// Returns -1 when deduction left cells to click on s->safe, otherwise the
+// best guess, or -2 when no undecided cell remains.
+static int solver_step(Solver *s) {
+    solver_deduce(s);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < s->safe.count; i++) {
+        if (!(s->cells[s->safe.items[i]] & CELL_CLICKED)) s->safe.items[kept++] = s->safe.items[i];
+    }
+    s->safe.count = kept;
+    if (kept > 0) return -1;
+
+    int guess = solver_probabilities(s);
+    if (s->safe.count > 0) return -1;
+    return guess >= 0 ? guess : -2;
+}
+
+static double elapsed_ms(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1e3 + (now.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static int default_start() {
+    return (board_height / 2) * board_width + board_width / 2;
+}
+
+// A candidate is still worth finishing while its slot is empty, and, for a
+// background layout, while the cursor is still on its start and no first click
+// is waiting on an urgent one.
+static bool layout_wanted(LayoutSlot *slot, int start) {
+    if (atomic_load(&layout_stop)) return false;
+    if (atomic_load_explicit(&slot->state, memory_order_acquire) != LAYOUT_EMPTY) return false;
+    if (slot == &layout_slots[URGENT_LAYOUT]) return atomic_load(&urgent_start) == start;
+    if (atomic_load(&pregen_start) != start) return false;
+    return atomic_load(&urgent_start) < 0 ||
+        atomic_load(&layout_slots[URGENT_LAYOUT].state) != LAYOUT_EMPTY;
+}
+
+// Takes a background slot for a worker: an empty one, or one holding a layout
+// for a start the cursor has since left.
+static LayoutSlot *claim_background_slot(int start) {
+    for (int i = 0; i < PREGEN_LAYOUTS; i++) {
+        if (atomic_load(&layout_slots[i].state) == LAYOUT_EMPTY) return &layout_slots[i];
+    }
+    for (int i = 0; i < PREGEN_LAYOUTS; i++) {
+        int expected = LAYOUT_READY;
+        if (atomic_load_explicit(&layout_slots[i].state, memory_order_acquire) == LAYOUT_READY &&
+            layout_slots[i].start != start &&
+            atomic_compare_exchange_strong(&layout_slots[i].state, &expected, LAYOUT_EMPTY)) {
+            return &layout_slots[i];
+        }
+    }
+    return NULL;
+}
+
+// Plays a layout from a click on start using deductions alone and reports
+// whether that uncovers every safe cell. Gives up as soon as the layout is no
+// longer wanted.
+static bool solves_without_guessing(Solver *s, uint8_t *cells, int start, IntList *queue, LayoutSlot *slot) {
+    solver_init(s, cells, board_width, board_height, mine_count);
+    int revealed = flood_reveal(cells, board_width, board_height, start, queue, &s->revealed);
+
+    while (layout_wanted(slot, start)) {
+        solver_deduce(s);
+        if (s->safe.count == 0) break;
+        for (size_t i = 0; i < s->safe.count; i++) {
+            int index = s->safe.items[i];
+            if (!(cells[index] & CELL_CLICKED)) {
+                revealed += flood_reveal(cells, board_width, board_height, index, queue, &s->revealed);
+            }
+        }
+        s->safe.count = 0;
+    }
+    return revealed == board_width * board_height - mine_count;
+}
+
+// Every worker deals its own candidate layouts for whichever slot is open and
+// checks them. The first to prove one solvable claims the slot; the others
+// notice the slot is no longer empty and abandon their candidates.
+static void *layout_worker(void *arg) {
+    uint32_t seed = (uint32_t) (uintptr_t) arg;
+    size_t cells = (size_t) board_width * board_height;
+    uint8_t *candidate = solver_alloc(cells);
+    Solver solver;
+    IntList queue = {0};
+    memset(&solver, 0, sizeof(solver));
+
+    while (!atomic_load(&layout_stop)) {
+        int start = atomic_load(&urgent_start);
+        LayoutSlot *slot = NULL;
+        if (start >= 0 && atomic_load(&layout_slots[URGENT_LAYOUT].state) == LAYOUT_EMPTY) {
+            slot = &layout_slots[URGENT_LAYOUT];
+        } else {
+            start = atomic_load(&pregen_start);
+            slot = claim_background_slot(start);
+        }
+        if (!slot) {
+            usleep(2000);
+            continue;
+        }
+
+        memset(candidate, 0, cells);
+        place_mines(candidate, board_width, board_height, mine_count, start % board_width, start / board_width, &seed);
+        if (!solves_without_guessing(&solver, candidate, start, &queue, slot)) continue;
+
+        int expected = LAYOUT_EMPTY;
+        if (!atomic_compare_exchange_strong(&slot->state, &expected, LAYOUT_FILLING)) continue;
+        for (size_t i = 0; i < cells; i++) slot->cells[i] = candidate[i] & ~CELL_CLICKED;
+        slot->start = start;
+        atomic_store_explicit(&slot->state, LAYOUT_READY, memory_order_release);
+    }
+
+    free(candidate);
+    free(solver.marks);
+    free(solver.revealed.items);
+    free(solver.dirty.items);
+    free(solver.clues.items);
+    free(solver.safe.items);
+    free(solver.found_mines.items);
+    free(queue.items);
+    return NULL;
+}
+
+static void start_layout_workers() {
+    for (int i = 0; i <= PREGEN_LAYOUTS; i++) {
+        layout_slots[i].cells = solver_alloc((size_t) board_width * board_height);
+        atomic_init(&layout_slots[i].state, LAYOUT_EMPTY);
+    }
+    atomic_init(&urgent_start, -1);
+    atomic_init(&pregen_start, default_start());
+    atomic_init(&layout_stop, false);
+
+    int count = solver_thread_count();
+    for (int i = 0; i < count; i++) {
+        uint32_t seed = ((uint32_t) time(NULL) ^ (uint32_t) (i + 1) * 2654435761u) | 1;
+        if (pthread_create(&layout_threads[i], NULL, layout_worker, (void *) (uintptr_t) seed) != 0) break;
+        layout_thread_count++;
+    }
+}
+
+static void stop_layout_workers() {
+    atomic_store(&layout_stop, true);
+    for (int i = 0; i < layout_thread_count; i++) {
+        pthread_join(layout_threads[i], NULL);
+    }
+    layout_thread_count = 0;
+}
+
+// Points background generation at the cell under the cursor, so the first
+// click usually finds a layout already waiting wherever it lands.
+static void follow_cursor_layouts() {
+    if (layout_thread_count == 0) return;
+    atomic_store(&pregen_start, player_pos.y * board_width + player_pos.x);
+}
+
+// Copies a logic-solvable layout for a first click at start onto the board.
+// A layout generated in the background for that cell is taken if there is
+// one; otherwise the whole pool races for it, with a notice if that takes a while. Returns
+// false if none turned up in time, leaving the caller to lay a random board
+// instead.
+static bool install_no_guess_layout(int start) {
+    LayoutSlot *slot = NULL;
+    for (int i = 0; i < PREGEN_LAYOUTS && !slot; i++) {
+        int expected = LAYOUT_READY;
+        if (atomic_load_explicit(&layout_slots[i].state, memory_order_acquire) == LAYOUT_READY &&
+            layout_slots[i].start == start &&
+            atomic_compare_exchange_strong(&layout_slots[i].state, &expected, LAYOUT_FILLING)) {
+            slot = &layout_slots[i];
+        }
+    }
+
+    if (!slot) {
+        if (layout_thread_count == 0) return false;
+        slot = &layout_slots[URGENT_LAYOUT];
+        atomic_store(&urgent_start, start);
+        bool announced = false;
 
-            if (board[dy][dx].mine) {
-                count++;
+        struct timespec begin;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        while (true) {
+            if (atomic_load_explicit(&slot->state, memory_order_acquire) == LAYOUT_READY) {
+                if (slot->start == start) break;
+                atomic_store(&slot->state, LAYOUT_EMPTY);
+            }
+            if (!announced && out.open && elapsed_ms(begin) > NO_GUESS_NOTICE_MS) {
+                out_printf(&out, "\nFinding a layout that needs no guessing...\n");
+                out_submit(&out);
+                announced = true;
             }
+            if (elapsed_ms(begin) > NO_GUESS_TIMEOUT_MS) {
+                atomic_store(&urgent_start, -1);
+                return false;
+            }
+            usleep(500);
         }
+        atomic_store(&urgent_start, -1);
+    }
+
+    memcpy(board, slot->cells, (size_t) board_width * board_height);
+    atomic_store_explicit(&slot->state, LAYOUT_EMPTY, memory_order_release);
+    return true;
+}
+
+static void plant_mines(int safeX, int safeY){ 
+    if (no_guess) {
+        no_guess_layout = install_no_guess_layout(safeY * board_width + safeX);
+        if (no_guess_layout) return;
     }
-    return count;
+    place_mines(board, board_width, board_height, mine_count, safeX, safeY, &mine_seed);
 }
 
 static void bounds_check() {
-    if (player_pos.x >= BOARD_WIDTH) {
-        player_pos.x = BOARD_WIDTH - 1;
+    if (player_pos.x >= board_width) {
+        player_pos.x = board_width - 1;
     } else if (player_pos.x < 0) {
         player_pos.x = 0;
     }
 
-    if (player_pos.y >= BOARD_HEIGHT) {
-        player_pos.y = BOARD_HEIGHT - 1;
+    if (player_pos.y >= board_height) {
+        player_pos.y = board_height - 1;
     } else if (player_pos.y < 0) {
         player_pos.y = 0;
     }
 }
 
 static bool win_check() {
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            if (!board[y][x].mine) {
-                if (!board[y][x].clicked) return false;
-            } 
-        }
-    }
-    return true;
+    return mines_planted && safe_remaining == 0;
 }
 
 static void click_square(int x, int y) {
-    if (x < 0 || x >= BOARD_WIDTH || y < 0 || y >= BOARD_HEIGHT) return;
-    if (board[y][x].flagged || board[y][x].clicked) return;
+    if (x < 0 || x >= board_width || y < 0 || y >= board_height) return;
+    uint8_t *cell = cell_at(x, y);
+    if (*cell & (CELL_FLAGGED | CELL_CLICKED)) return;
 
-    board[y][x].clicked = true;
     board_changed = true;
+    if (*cell & CELL_MINE) {
+        *cell |= CELL_CLICKED;
+        loss = true;
+        return;
+    }
+    IntList *log = game_solver.marks ? &game_solver.revealed : NULL;
+    safe_remaining -= flood_reveal(board, board_width, board_height, y * board_width + x, &reveal_queue, log);
+}
 
-    if (board[y][x].mine) loss = true; 
-    if (get_near(x, y) != 0) return;
+static void enable_solver() {
+    if (game_solver.marks) return;
+    solver_init(&game_solver, board, board_width, board_height, mine_count);
+    for (int i = 0; i < board_width * board_height; i++) {
+        if (board[i] & CELL_CLICKED) list_push(&game_solver.revealed, i);
+    }
+}
 
-    for (int dy = y - 1; dy <= y + 1; dy++) {
-        for (int dx = x - 1; dx <= x + 1; dx++) {
-            if (dx == x && dy == y) continue; 
-            click_square(dx, dy);
-            if (win_check()) {
-                printf("\nGame Over, You Win!\n");
-                cleanup_terminal();
-                exit(0);
-            }
+static void reveal_for_solver(int index) {
+    int x = index % board_width, y = index / board_width;
+    if (board[index] & CELL_FLAGGED) {
+        board[index] &= ~CELL_FLAGGED;
+        flags_placed--;
+    }
+    click_square(x, y);
+    player_pos.x = x;
+    player_pos.y = y;
+}
+
+// Makes one solver move: every deduced safe cell at once, or a single best
+// guess. Only the solver's thinking time is counted, not the reveals. Returns
+// false when the solver has nothing left to click.
+static bool autoplay_step() {
+    enable_solver();
+    if (!mines_planted) {
+        plant_mines(player_pos.x, player_pos.y);
+        mines_planted = true;
+        click_square(player_pos.x, player_pos.y);
+        return true;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int guess = solver_step(&game_solver);
+    solver_last_ms = elapsed_ms(start);
+    solver_total_ms += solver_last_ms;
+    if (solver_last_ms > solver_max_ms) solver_max_ms = solver_last_ms;
+    solver_moves++;
+
+    for (size_t i = 0; i < game_solver.found_mines.count; i++) {
+        int index = game_solver.found_mines.items[i];
+        if (!(board[index] & CELL_FLAGGED)) {
+            board[index] |= CELL_FLAGGED;
+            flags_placed++;
         }
     }
+    game_solver.found_mines.count = 0;
+
+    if (guess == -1) {
+        for (size_t i = 0; i < game_solver.safe.count && !loss; i++) {
+            reveal_for_solver(game_solver.safe.items[i]);
+        }
+        game_solver.safe.count = 0;
+    } else if (guess >= 0) {
+        reveal_for_solver(guess);
+    }
+    board_changed = true;
+    return guess != -2;
+}
+
+// Refreshes the overlay without moving: deductions plus probabilities.
+static void analyze_board() {
+    enable_solver();
+    if (!mines_planted) return;
+    solver_deduce(&game_solver);
+    solver_probabilities(&game_solver);
+    game_solver.found_mines.count = 0;
 }
 
 static void reset_board() {
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            board[y][x].pos.x = x;
-            board[y][x].pos.y = y;
-            board[y][x].flagged = false;
-            board[y][x].clicked = false;
-            board[y][x].mine = false;
-            board[y][x].close = 0;
-        }
-    }
-    player_pos.x = BOARD_WIDTH / 2;
-    player_pos.y = BOARD_HEIGHT / 2;
+    memset(board, 0, (size_t) board_width * board_height);
+    player_pos.x = board_width / 2;
+    player_pos.y = board_height / 2;
     flags_placed = 0;
+    safe_remaining = board_width * board_height - mine_count;
     mines_planted = false;
+    no_guess_layout = false;
     loss = false;
     board_changed = true;
+    if (game_solver.marks) solver_reset(&game_solver);
+}
+
+static void run_solver_bench(int games) {
+    int wins = 0;
+    long total_moves = 0;
+    double total_ms = 0, max_ms = 0;
+    mine_seed = 0x9E3779B9u;
+
+    for (int game = 0; game < games; game++) {
+        reset_board();
+        solver_moves = 0;
+        solver_total_ms = 0;
+        solver_max_ms = 0;
+        while (!loss && !win_check()) {
+            if (!autoplay_step()) break;
+        }
+
+        if (!loss) wins++;
+        total_moves += solver_moves;
+        total_ms += solver_total_ms;
+        if (solver_max_ms > max_ms) max_ms = solver_max_ms;
+    }
+    printf("%d games on %dx%d with %d mines: %d wins (%.1f%%), %.3f ms/move avg, %.3f ms max over %ld moves\n",
+        games, board_width, board_height, mine_count, wins, 100.0 * wins / games,
+        total_moves ? total_ms / total_moves : 0, max_ms, total_moves);
 }
 
 static void process_input() {
@@ -246,18 +1460,20 @@ static void process_input() {
             }
             break;
 
-        case 'f': case 'F': 
-            if (!board[player_pos.y][player_pos.x].clicked) {
-                if (!board[player_pos.y][player_pos.x].flagged && flags_placed < MAX_FLAGS) {
-                    board[player_pos.y][player_pos.x].flagged = true; 
+        case 'f': case 'F': {
+            uint8_t *cell = cell_at(player_pos.x, player_pos.y);
+            if (!(*cell & CELL_CLICKED)) {
+                if (!(*cell & CELL_FLAGGED) && flags_placed < mine_count) {
+                    *cell |= CELL_FLAGGED; 
                     flags_placed++;
-                } else if (board[player_pos.y][player_pos.x].flagged) {
-                    board[player_pos.y][player_pos.x].flagged = false;
+                } else if (*cell & CELL_FLAGGED) {
+                    *cell &= ~CELL_FLAGGED;
                     flags_placed--;
                 }
                 board_changed = true;
             }
             break;
+        }
 
         case ' ': 
             if (!mines_planted) {
@@ -266,17 +1482,36 @@ static void process_input() {
             }
             click_square(player_pos.x,player_pos.y);
             if (win_check()) {
+                out_close(&out);
+                stats_close(&stats);
                 printf("\nGame Over, You Win!\n");
                 cleanup_terminal();
                 exit(0);
             }
             break;
 
+        case 'g': case 'G':
+            autoplay = !autoplay;
+            board_changed = true;
+            break;
+
+        case 'o': case 'O':
+            show_odds = !show_odds;
+            board_changed = true;
+            break;
+
         case 'r': case 'R':
             reset_board();
             break;
 
+        case 't': case 'T':
+            stats_visible = !stats_visible;
+            board_changed = true;
+            break;
+
         case 'q': case 'Q':
+            out_close(&out);
+            stats_close(&stats);
             cleanup_terminal();
             printf("\nGame Over\n");
             exit(0);
@@ -287,84 +1522,237 @@ static void process_input() {
     }
 }
 
+static void terminal_size(int *cols, int *rows) {
+    *cols = 80;
+    *rows = 24;
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        *cols = info.srWindow.Right - info.srWindow.Left + 1;
+        *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    }
+#else
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+        *cols = ws.ws_col;
+        *rows = ws.ws_row;
+    }
+#endif
+}
+
+// Sizes the viewport to the terminal and scrolls it just far enough to keep
+// the cursor on screen.
+static void update_viewport(int *view_width, int *view_height) {
+    int cols, rows;
+    terminal_size(&cols, &rows);
+
+    *view_width = (cols - 1) / 4;
+    *view_height = (rows - FOOTER_LINES - (stats_visible ? STATS_OVERLAY_LINES : 0) - 1) / 2;
+    if (*view_width < 1) *view_width = 1;
+    if (*view_height < 1) *view_height = 1;
+    if (*view_width > board_width) *view_width = board_width;
+    if (*view_height > board_height) *view_height = board_height;
+
+    if (player_pos.x < view_origin.x) view_origin.x = player_pos.x;
+    if (player_pos.x >= view_origin.x + *view_width) view_origin.x = player_pos.x - *view_width + 1;
+    if (player_pos.y < view_origin.y) view_origin.y = player_pos.y;
+    if (player_pos.y >= view_origin.y + *view_height) view_origin.y = player_pos.y - *view_height + 1;
+
+    if (view_origin.x > board_width - *view_width) view_origin.x = board_width - *view_width;
+    if (view_origin.y > board_height - *view_height) view_origin.y = board_height - *view_height;
+    if (view_origin.x < 0) view_origin.x = 0;
+    if (view_origin.y < 0) view_origin.y = 0;
+}
+
 static void render() {
-    printf("┌");
-    for (int x = 0; x < BOARD_WIDTH; x++) {
-        printf("───");
-        if (x < BOARD_WIDTH - 1) printf("┬");
+    int view_width, view_height;
+    update_viewport(&view_width, &view_height);
+    int left = view_origin.x, top = view_origin.y;
+
+    out_printf(&out, "┌");
+    for (int x = 0; x < view_width; x++) {
+        out_printf(&out, "───");
+        if (x < view_width - 1) out_printf(&out, "┬");
     }
-    printf("┐\n");
+    out_printf(&out, "┐\n");
     
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        printf("│");
-        for (int x = 0; x < BOARD_WIDTH; x++) {
+    for (int y = top; y < top + view_height; y++) {
+        out_printf(&out, "│");
+        for (int x = left; x < left + view_width; x++) {
             bool is_cursor = (x == player_pos.x && y == player_pos.y);
+            uint8_t cell = *cell_at(x, y);
             
-            if (is_cursor) printf("\033[7m"); 
-
-            if (loss && board[y][x].mine) {
-                printf("\033[31m * \033[0m");
-            } else if (!board[y][x].clicked && !board[y][x].flagged) {
-                printf("   ");  
-            } else if (board[y][x].clicked) {
-                if (board[y][x].mine) {
-                    printf("\033[31m * \033[0m");
-                    if (is_cursor) printf("\033[7m");
+            if (is_cursor) out_printf(&out, "\033[7m"); 
+
+            if (loss && (cell & CELL_MINE)) {
+                out_printf(&out, "\033[31m * \033[0m");
+            } else if (!(cell & (CELL_CLICKED | CELL_FLAGGED))) {
+                int odds = ODDS_NONE;
+                if (show_odds && mines_planted && game_solver.marks) {
+                    odds = get_odds(&game_solver, y * board_width + x);
+                    if (odds == ODDS_NONE) odds = game_solver.interior_odds;
+                    if (odds == ODDS_SAFE) odds = 0;
+                    if (odds == ODDS_MINE) odds = 100;
+                }
+                if (odds == ODDS_NONE) {
+                    out_printf(&out, "   ");  
+                } else {
+                    out_printf(&out, "\033[%dm%3d\033[0m", odds <= 20 ? 32 : odds <= 50 ? 33 : 31, odds);
+                    if (is_cursor) out_printf(&out, "\033[7m");
+                }
+            } else if (cell & CELL_CLICKED) {
+                if (cell & CELL_MINE) {
+                    out_printf(&out, "\033[31m * \033[0m");
+                    if (is_cursor) out_printf(&out, "\033[7m");
                 } else {
-                    int nearby = get_near(x, y);
-                    printf(" %d ", nearby);
+                    out_printf(&out, " %d ", cell & CELL_COUNT_MASK);
                 }
-            } else if (board[y][x].flagged) {
-                printf("\033[32m f \033[0m");
-                if (is_cursor) printf("\033[7m");
+            } else if (cell & CELL_FLAGGED) {
+                out_printf(&out, "\033[32m f \033[0m");
+                if (is_cursor) out_printf(&out, "\033[7m");
             }
             
-            if (is_cursor) printf("\033[0m"); 
-            printf("│");
+            if (is_cursor) out_printf(&out, "\033[0m"); 
+            out_printf(&out, "│");
 
         }
-        printf("\n");
+        out_printf(&out, "\n");
 
-        if (y < BOARD_HEIGHT - 1) {
-            printf("├");
-            for (int x = 0; x < BOARD_WIDTH; x++) {
-                printf("───");
-                if (x < BOARD_WIDTH - 1) printf("┼");
+        if (y < top + view_height - 1) {
+            out_printf(&out, "├");
+            for (int x = 0; x < view_width; x++) {
+                out_printf(&out, "───");
+                if (x < view_width - 1) out_printf(&out, "┼");
             }
-            printf("┤\n");
+            out_printf(&out, "┤\n");
         }
     }
 
-    printf("└");
-    for (int x = 0; x < BOARD_WIDTH; x++) {
-        printf("───");
-        if (x < BOARD_WIDTH - 1) printf("┴");
+    out_printf(&out, "└");
+    for (int x = 0; x < view_width; x++) {
+        out_printf(&out, "───");
+        if (x < view_width - 1) out_printf(&out, "┴");
     }
-    printf("┘\n");
+    out_printf(&out, "┘\n");
 
-    printf("Position: (%d,%d) | Flags Remaining: %d\n Controls\n WASD / Arrow to Move\n Space to Click\n F to Flag\n Q to Quit\n R to Reset", player_pos.x, player_pos.y, MAX_FLAGS - flags_placed);
-    fflush(stdout); 
+    out_printf(&out, "Position: (%d,%d) of %dx%d | Flags Remaining: %d", player_pos.x, player_pos.y, board_width, board_height, mine_count - flags_placed);
+    if (no_guess && mines_planted) {
+        if (no_guess_layout) {
+            out_printf(&out, " | No guessing needed");
+        } else {
+            out_printf(&out, " | \033[33mNo no-guess layout found in time; this board may need a guess\033[0m");
+        }
+    }
+    out_printf(&out, "\n");
+    if (solver_moves > 0) {
+        out_printf(&out, "Solver: %.3f ms last, %.3f ms avg, %.3f ms max over %ld moves\n", solver_last_ms, solver_total_ms / solver_moves, solver_max_ms, solver_moves);
+    } else {
+        out_printf(&out, "Solver: %s\n", autoplay ? "starting" : "idle");
+    }
+    out_printf(&out, " Controls\n WASD / Arrow to Move\n Space to Click\n F to Flag\n G to Autoplay\n O for Odds\n Q to Quit\n R to Reset\n T for Frame Stats");
+    if (stats_visible) {
+        char line[128];
+        for (int i = 0; i < STATS_OVERLAY_LINES; i++) {
+            stats_overlay_line(&stats, i, line, sizeof(line));
+            out_printf(&out, "\n%s", line);
+        }
+    }
 }
 
-int main() {
-    srand(time(NULL));
-    setup_terminal();
-    reset_board();
-    system(CLEAR_CMD);
+// Sends the board as one frame and records it with the timings of the tick
+// that drew it; the caller checks the terminal is ready.
+static void draw_frame(long input_ns, long update_ns) {
+    long long build_start = stats_now_ns();
+    if (show_odds && !autoplay) analyze_board();
+    out_printf(&out, CLEAR_SCREEN);
     render();
+    long long build_done = stats_now_ns();
+    out_submit(&out);
+    stats_record_frame(&stats, input_ns, update_ns, build_start, build_done, out.bytes_written, out.syscalls);
     board_changed = false;
+}
 
+int main(int argc, char *argv[]) {
+    bool mines_given = false;
+    int bench_games = 0;
+    const char *stats_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            board_width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+            board_height = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mines") == 0 && i + 1 < argc) {
+            mine_count = atoi(argv[++i]);
+            mines_given = true;
+        } else if (strcmp(argv[i], "--no-guess") == 0) {
+            no_guess = true;
+        } else if (strcmp(argv[i], "--autoplay") == 0) {
+            autoplay = true;
+        } else if (strcmp(argv[i], "--solver-bench") == 0 && i + 1 < argc) {
+            bench_games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stats-file") == 0 && i + 1 < argc) {
+            stats_path = argv[++i];
+        }
+    }
+    if (board_width < MIN_BOARD_DIM || board_width > MAX_BOARD_DIM ||
+        board_height < MIN_BOARD_DIM || board_height > MAX_BOARD_DIM) {
+        printf("Board dimensions must be between %d and %d\n", MIN_BOARD_DIM, MAX_BOARD_DIM);
+        return 1;
+    }
+    if (!mines_given) {
+        mine_count = (int) ((long long) board_width * board_height * MINE_PERCENT / 100);
+    }
+    if (mine_count < 0 || mine_count > board_width * board_height - 9) {
+        printf("Mine count must be between 0 and %d for a %dx%d board\n", board_width * board_height - 9, board_width, board_height);
+        return 1;
+    }
+    if (!stats_open(&stats, stats_path)) {
+        printf("Could not open %s for writing\n", stats_path);
+        return 1;
+    }
+
+    mine_seed = (uint32_t) time(NULL) | 1;
+    init_board();
+    if (no_guess) start_layout_workers();
+    if (bench_games > 0) {
+        run_solver_bench(bench_games);
+        stop_layout_workers();
+        return 0;
+    }
+    setup_terminal();
+    out_init(&out, STDOUT_FILENO);
+    reset_board();
+    draw_frame(0, 0);
+
+    // Changes made while the terminal is still busy with the last frame are
+    // drawn together once it catches up.
+    long input_ns = 0, update_ns = 0;
     while (!loss) {
+        long long tick_start = stats_now_ns();
         process_input();
-        if (board_changed) {
-            system(CLEAR_CMD);
-            render();
-            board_changed = false;
+        long long input_done = stats_now_ns();
+        if (no_guess && !mines_planted) follow_cursor_layouts();
+        if (autoplay && !loss && !win_check() && !autoplay_step()) autoplay = false;
+        input_ns = input_done - tick_start;
+        update_ns = stats_now_ns() - input_done;
+        if (board_changed && out_ready(&out)) {
+            draw_frame(input_ns, update_ns);
+            if (mines_planted && win_check()) {
+                out_close(&out);
+                stats_close(&stats);
+                printf("\nGame Over, You Win!\n");
+                cleanup_terminal();
+                exit(0);
+            }
         }
         
         usleep(MICROSECONDS_PER_TICK);
     }
+    if (board_changed) draw_frame(input_ns, update_ns);
     
+    stop_layout_workers();
+    out_close(&out);
+    stats_close(&stats);
     cleanup_terminal();
     return 0;
 }
\ No newline at end of file
@@ -1,24 +1,46 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include <unistd.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "triple_buffer.h"
+#include "term_output.h"
+#include "frame_stats.h"
+#include "game_loop.h"
 
 #ifdef _WIN32
     #include <conio.h>
     #include <windows.h>
-    #define CLEAR_CMD "cls"
 #else
     #include <termios.h>
     #include <fcntl.h>
-    #define CLEAR_CMD "clear"
+    #include <sys/ioctl.h>
 #endif
 
 #define TICK_RATE 10
 #define MICROSECONDS_PER_TICK (1000000 / TICK_RATE)
-#define BOARD_WIDTH 12
-#define BOARD_HEIGHT 8
-#define MAX_SNAKE_LENGTH 100
+#define DEFAULT_WIDTH 12
+#define DEFAULT_HEIGHT 8
+#define MIN_BOARD_DIM 4
+#define MAX_BOARD_DIM 1000
+#define START_LENGTH 3
+#define FOOTER_LINES 5
+#define CLEAR_SCREEN "\033[H\033[2J"
+#define SHORTCUT_BFS_CELLS 4096
+#define ARENA_TICK_RATE 60
+#define ARENA_DEFAULT_DIM 2000
+#define ARENA_MAX_DIM 4000
+#define ARENA_MAX_SNAKES 10000
+#define ARENA_MAX_LENGTH 1024
+#define ARENA_FOOD_PER_SNAKE 2
+#define ARENA_LOOKAHEAD 24
+#define ARENA_TARGET_SAMPLES 8
+#define ARENA_CHUNK 64
+#define ARENA_MAX_THREADS 16
 
 typedef struct {
     int x, y;
@@ -28,12 +50,78 @@ typedef enum {
     DIR_NONE, DIR_UP, DIR_DOWN, DIR_LEFT, DIR_RIGHT
 } Direction; 
 
-static char board[BOARD_HEIGHT][BOARD_WIDTH];
-static Position snake[MAX_SNAKE_LENGTH]; 
-static int snake_length = 3;
-static int snake_head = 0;  
+// What the render thread needs from one tick: the cells in view, row by row,
+// in arena_grid's encoding (0 empty, id + 1 for a snake, negative for food),
+// and the footer figures. The sequence number is the tick. The classic game's
+// snake is id 0 and its apple is food. Each slot owns its cells, which the
+// simulation grows when the view does.
+typedef struct {
+    FrameInfo info;
+    bool stats_visible;
+    int view_width;
+    int view_height;
+    int follow;
+    int length;
+    int alive;
+    long deaths;
+    double step_ms;
+    double ticks_per_second;
+    int *cells;
+    int cell_capacity;
+} Snapshot;
+
+static int board_width = DEFAULT_WIDTH;
+static int board_height = DEFAULT_HEIGHT;
+static int cell_count = DEFAULT_WIDTH * DEFAULT_HEIGHT;
+
+// The body is a ring deque of cells, oldest first, whose capacity is the
+// board area rounded up to a power of two, so indexes wrap with a mask and a
+// snake that fills the board never needs to grow it.
+static Position *snake = NULL;
+static int snake_mask = 0;
+static int snake_tail = 0;
+static int snake_length = 0;
 static Direction current_direction = DIR_NONE;
 static Position apple; 
+static int grow_pending = 0;
+static uint32_t rng_state = 1;
+static Position view_origin = {0, 0};
+static int arena_follow = 0;
+static TermOutput out;
+static FrameStats stats;
+static bool stats_visible = false;
+
+// The simulation runs on its own thread and publishes a Snapshot after every
+// tick; the render thread draws the newest one whenever the terminal is ready
+// for it. end_message is set before running is cleared and printed by main
+// once both threads have stopped.
+static Snapshot snapshot_slots[3];
+static TripleBuffer snapshots;
+static atomic_bool running;
+static const char *end_message = "";
+
+// One bit per cell for the snake body, plus every empty cell kept in an
+// indexed set: free_slot[cell] is where the cell sits in free_cells, or -1.
+static uint64_t *occupancy = NULL;
+static int *free_cells = NULL;
+static int *free_slot = NULL;
+static int free_count = 0;
+
+// Autopilot state. The cycle visits every cell once: cycle_index[cell] is a
+// cell's place on it and cycle_cell[] is the inverse. The BFS scratch buffers
+// are sized to the board once, and a planned shortcut is kept in path[] from
+// path_pos onwards until the head reaches the apple it was planned for.
+static bool autopilot = false;
+static int *cycle_index = NULL;
+static int *cycle_cell = NULL;
+static int *bfs_queue = NULL;
+static int *bfs_parent = NULL;
+static uint32_t *bfs_seen = NULL;
+static uint32_t bfs_stamp = 0;
+static int *path = NULL;
+static int path_length = 0;
+static int path_pos = 0;
+static int path_apple = -1;
 
 #ifndef _WIN32
 static struct termios original_termios;
@@ -86,11 +174,102 @@ static char read_char() {
 }
 #endif
 
+static void stop_game(const char *message) {
+    end_message = message;
+    atomic_store(&running, false);
+}
+
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void init_board() {
+    int capacity = 1;
+    while (capacity < cell_count) capacity <<= 1;
+
+    snake = malloc((size_t) capacity * sizeof(Position));
+    snake_mask = capacity - 1;
+    occupancy = calloc((cell_count + 63) / 64, sizeof(uint64_t));
+    free_cells = malloc((size_t) cell_count * sizeof(int));
+    free_slot = malloc((size_t) cell_count * sizeof(int));
+    if (!snake || !occupancy || !free_cells || !free_slot) {
+        fprintf(stderr, "Not enough memory for a %dx%d board\n", board_width, board_height);
+        exit(1);
+    }
+}
+
+static inline Position snake_at(int i) {
+    return snake[(snake_tail + i) & snake_mask];
+}
+
+static inline Position snake_head_pos() {
+    return snake_at(snake_length - 1);
+}
+
+static bool is_occupied(int cell) {
+    return (occupancy[cell / 64] >> (cell % 64)) & 1;
+}
+
+static void occupy_cell(Position pos) {
+    int cell = pos.y * board_width + pos.x;
+    int slot = free_slot[cell];
+    int last = free_cells[--free_count];
+
+    free_cells[slot] = last;
+    free_slot[last] = slot;
+    free_slot[cell] = -1;
+    occupancy[cell / 64] |= 1ULL << (cell % 64);
+}
+
+static void release_cell(Position pos) {
+    int cell = pos.y * board_width + pos.x;
+
+    free_slot[cell] = free_count;
+    free_cells[free_count++] = cell;
+    occupancy[cell / 64] &= ~(1ULL << (cell % 64));
+}
+
+static void push_head(Position pos) {
+    snake[(snake_tail + snake_length) & snake_mask] = pos;
+    snake_length++;
+    occupy_cell(pos);
+}
+
+static void pop_tail() {
+    release_cell(snake[snake_tail]);
+    snake_tail = (snake_tail + 1) & snake_mask;
+    snake_length--;
+}
+
 static void init_snake() {
-    Position start_pos = {BOARD_WIDTH / 2, BOARD_HEIGHT / 2};
-    for (int i = 0; i < snake_length; i++) {
-        snake[i].x = start_pos.x;
-        snake[i].y = start_pos.y + i;
+    Position start_pos = {board_width / 2, board_height / 2};
+
+    memset(occupancy, 0, (cell_count + 63) / 64 * sizeof(uint64_t));
+    free_count = 0;
+    for (int cell = 0; cell < cell_count; cell++) {
+        free_slot[cell] = free_count;
+        free_cells[free_count++] = cell;
+    }
+
+    snake_tail = 0;
+    snake_length = 0;
+    grow_pending = 0;
+    if (autopilot) {
+        // The autopilot relies on the body lying in cycle order, tail first.
+        for (int i = 0; i < START_LENGTH; i++) {
+            push_head((Position){cycle_cell[i] % board_width, cycle_cell[i] / board_width});
+        }
+        path_length = path_pos = 0;
+        path_apple = -1;
+        return;
+    }
+    for (int i = START_LENGTH - 1; i >= 0; i--) {
+        push_head((Position){start_pos.x, start_pos.y + i});
     }
 }
 
@@ -128,22 +307,40 @@ static void process_input() {
 
     switch (key) {
         case 'q': case 'Q':
-            cleanup_terminal();
-            printf("\nGame over! Thanks for playing.\n");
-            exit(0);
+            stop_game("\nGame over! Thanks for playing.\n");
             break;
         case 'w': case 'W': current_direction = DIR_UP; break;
         case 's': case 'S': current_direction = DIR_DOWN; break;
         case 'd': case 'D': current_direction = DIR_RIGHT; break;
         case 'a': case 'A': current_direction = DIR_LEFT; break;
         case ' ': current_direction = DIR_NONE; break;
+        case '[': arena_follow--; break;
+        case ']': arena_follow++; break;
+        case 't': case 'T': stats_visible = !stats_visible; break;
     }
 }
 
-static void move_snake() {
-    if (current_direction == DIR_NONE) return;
+static void game_over() {
+    stop_game("\nGame Over\n");
+}
 
-    Position new_head = snake[snake_head];
+static void place_apple() {
+    if (free_count == 0) {
+        stop_game("\n You Win!!!\n");
+        return;
+    }
+    int cell = free_cells[next_random(&rng_state) % (uint32_t) free_count];
+    apple.x = cell % board_width;
+    apple.y = cell / board_width;
+}
+
+// Moves the head one cell. The tail leaves first, so the head may follow it
+// into the cell it just vacated; while growing the tail stays put. Returns
+// false if the move ended the game.
+static bool move_snake() {
+    if (current_direction == DIR_NONE) return true;
+
+    Position new_head = snake_head_pos();
     
     switch(current_direction) {
         case DIR_UP: new_head.y--; break;
@@ -153,135 +350,1005 @@ static void move_snake() {
         case DIR_NONE: break;
     }
 
-    snake_head = (snake_head + 1) % snake_length;
-    snake[snake_head] = new_head;
+    if (new_head.x < 0 || new_head.x >= board_width ||
+        new_head.y < 0 || new_head.y >= board_height) {
+        game_over();
+        return false;
+    }
+
+    if (grow_pending > 0) {
+        grow_pending--;
+    } else {
+        pop_tail();
+    }
+
+    if (is_occupied(new_head.y * board_width + new_head.x)) {
+        game_over();
+        return false;
+    }
+    push_head(new_head);
+    return true;
 }
 
-static bool is_position_occupied(int x, int y) {
-    for (int i = 0; i < snake_length; i++) {
-        if (snake[i].x == x && snake[i].y == y) {
-            return true;
+// Lays a Hamiltonian cycle over the board. With an even number of rows it
+// runs along the top row, snakes back and forth through columns 1.. of the
+// remaining rows and returns up column 0; with only an even number of columns
+// the same walk is taken on the transposed board. Returns false when both
+// sides are odd, as no cycle exists then.
+static bool build_cycle() {
+    bool transpose = board_height % 2 != 0;
+    int cols = transpose ? board_height : board_width;
+    int rows = transpose ? board_width : board_height;
+    if (rows % 2 != 0) return false;
+
+    size_t cells = (size_t) cell_count;
+    cycle_index = malloc(cells * sizeof(int));
+    cycle_cell = malloc(cells * sizeof(int));
+    bfs_queue = malloc(cells * sizeof(int));
+    bfs_parent = malloc(cells * sizeof(int));
+    bfs_seen = calloc(cells, sizeof(uint32_t));
+    path = malloc(cells * sizeof(int));
+    if (!cycle_index || !cycle_cell || !bfs_queue || !bfs_parent || !bfs_seen || !path) {
+        fprintf(stderr, "Not enough memory for the autopilot\n");
+        exit(1);
+    }
+
+    int order = 0;
+    for (int r = 0; r < rows; r++) {
+        for (int i = 0; i < cols - 1; i++) {
+            int c = (r == 0) ? i : (r % 2 ? cols - 1 - i : i + 1);
+            int cell = transpose ? c * board_width + r : r * board_width + c;
+            cycle_cell[order++] = cell;
+        }
+        if (r == 0) {
+            int cell = transpose ? (cols - 1) * board_width : cols - 1;
+            cycle_cell[order++] = cell;
         }
     }
-    return false;
+    for (int r = rows - 1; r >= 1; r--) {
+        cycle_cell[order++] = transpose ? r : r * board_width;
+    }
+    for (int i = 0; i < cell_count; i++) {
+        cycle_index[cycle_cell[i]] = i;
+    }
+    return true;
 }
 
-static void place_apple() {
-    int attempts = 0;
-    const int max_attempts = 100;
-
-    do {
-        apple.x = rand() % BOARD_WIDTH;   
-        apple.y = rand() % BOARD_HEIGHT; 
-        attempts++;
-    } while (is_position_occupied(apple.x, apple.y) && attempts < max_attempts);
-
-    if (attempts >= max_attempts) {
-        for (int y = 0; y < BOARD_HEIGHT; y++) {
-            for (int x = 0; x < BOARD_WIDTH; x++) {
-                if (!is_position_occupied(x, y)) {
-                    apple.x = x;
-                    apple.y = y;
-                    return;
+// How far ahead of the tail a cell lies along the cycle. The body always
+// occupies increasing distances from tail to head, so every cell further
+// ahead than the head is free.
+static inline int cycle_distance(int cell, int tail) {
+    int d = cycle_index[cell] - cycle_index[tail];
+    return d < 0 ? d + cell_count : d;
+}
+
+// Fills out[] with the up, down, left and right neighbours of a cell, using -1
+// past the edges.
+static void neighbour_cells(int cell, int out[4]) {
+    int x = cell % board_width, y = cell / board_width;
+    out[0] = y > 0 ? cell - board_width : -1;
+    out[1] = y < board_height - 1 ? cell + board_width : -1;
+    out[2] = x > 0 ? cell - 1 : -1;
+    out[3] = x < board_width - 1 ? cell + 1 : -1;
+}
+
+// Breadth-first search from the head to the apple over cells lying between
+// them along the cycle, only ever stepping further ahead. Such a path cannot
+// overtake the tail or pass the apple, so it is as safe as the cycle itself.
+// The route is stored in path[] in walking order.
+static void plan_shortcut(int head, int tail, int target) {
+    int head_distance = cycle_distance(head, tail);
+    int target_distance = cycle_distance(target, tail);
+    int front = 0, back = 0;
+
+    if (++bfs_stamp == 0) {
+        memset(bfs_seen, 0, (size_t) cell_count * sizeof(uint32_t));
+        bfs_stamp = 1;
+    }
+    path_apple = target;
+    path_length = path_pos = 0;
+
+    bfs_queue[back++] = head;
+    bfs_seen[head] = bfs_stamp;
+    while (front < back && bfs_seen[target] != bfs_stamp) {
+        int cell = bfs_queue[front++];
+        int distance = cycle_distance(cell, tail);
+        int neighbours[4];
+        neighbour_cells(cell, neighbours);
+
+        for (int i = 0; i < 4; i++) {
+            int next = neighbours[i];
+            if (next < 0 || bfs_seen[next] == bfs_stamp) continue;
+            int d = cycle_distance(next, tail);
+            if (d <= distance || d <= head_distance || d > target_distance) continue;
+            bfs_seen[next] = bfs_stamp;
+            bfs_parent[next] = cell;
+            bfs_queue[back++] = next;
+        }
+    }
+    if (bfs_seen[target] != bfs_stamp) return;
+
+    for (int cell = target; cell != head; cell = bfs_parent[cell]) {
+        path_length++;
+    }
+    int i = path_length;
+    for (int cell = target; cell != head; cell = bfs_parent[cell]) {
+        path[--i] = cell;
+    }
+}
+
+static bool is_safe_step(int cell, int tail) {
+    return !is_occupied(cell) || (cell == tail && grow_pending == 0);
+}
+
+// Picks the autopilot's next move. It follows the cycle, except that while
+// the snake covers under half the board it cuts across towards the apple,
+// provided the cycle beyond the apple still has room for the whole body; that
+// keeps the gaps a shortcut leaves from trapping it. Once the stretch of cycle
+// up to the apple is small enough the route is planned by BFS, once per apple;
+// further out the head just takes whichever neighbour jumps furthest ahead
+// without passing the apple, so no tick costs more than a small search.
+static Direction autopilot_direction() {
+    Position head_pos = snake_head_pos();
+    Position tail_pos = snake_at(0);
+    int head = head_pos.y * board_width + head_pos.x;
+    int tail = tail_pos.y * board_width + tail_pos.x;
+    int target = apple.y * board_width + apple.x;
+    int head_distance = cycle_distance(head, tail);
+    int target_distance = cycle_distance(target, tail);
+    int neighbours[4];
+    int next = -1;
+
+    neighbour_cells(head, neighbours);
+    if (path_apple == target && path_pos < path_length) {
+        next = path[path_pos++];
+    } else if (2 * (snake_length + grow_pending) < cell_count &&
+        target_distance > head_distance &&
+        cell_count - target_distance > snake_length + grow_pending + 1) {
+        if (path_apple != target && target_distance - head_distance <= SHORTCUT_BFS_CELLS) {
+            plan_shortcut(head, tail, target);
+            if (path_length > 0) next = path[path_pos++];
+        } else {
+            int best = head_distance;
+            for (int i = 0; i < 4; i++) {
+                if (neighbours[i] < 0) continue;
+                int d = cycle_distance(neighbours[i], tail);
+                if (d > best && d <= target_distance) {
+                    best = d;
+                    next = neighbours[i];
                 }
             }
         }
-        cleanup_terminal();
-        printf("\n You Win!!!\n");
-        exit(0);
     }
+    if (next < 0) {
+        int order = cycle_index[head] + 1;
+        next = cycle_cell[order == cell_count ? 0 : order];
+    }
+
+    if (!is_safe_step(next, tail)) {
+        // Only reachable if the body has left cycle order; take any way out.
+        next = -1;
+        for (int i = 0; i < 4 && next < 0; i++) {
+            if (neighbours[i] >= 0 && is_safe_step(neighbours[i], tail)) next = neighbours[i];
+        }
+        path_length = path_pos = 0;
+        if (next < 0) return DIR_NONE;
+    }
+
+    if (next == head - board_width) return DIR_UP;
+    if (next == head + board_width) return DIR_DOWN;
+    if (next == head - 1) return DIR_LEFT;
+    return DIR_RIGHT;
+}
+
+static double elapsed_ms(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1e3 + (now.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+// Plays whole games headless and reports how long filling the board takes.
+static void run_autopilot_bench(int games) {
+    int filled = 0;
+    long total_ticks = 0, decisions = 0;
+    double total_ms = 0, max_ms = 0;
+    rng_state = 0x9E3779B9u;
+
+    for (int game = 0; game < games; game++) {
+        init_snake();
+        place_apple();
+        long ticks = 0;
+
+        while (true) {
+            struct timespec begin;
+            clock_gettime(CLOCK_MONOTONIC, &begin);
+            current_direction = autopilot_direction();
+            double ms = elapsed_ms(begin);
+            decisions++;
+            total_ms += ms;
+            if (ms > max_ms) max_ms = ms;
+            if (current_direction == DIR_NONE) break;
+
+            ticks++;
+            if (!move_snake()) break;
+            Position head = snake_head_pos();
+            if (head.x == apple.x && head.y == apple.y) {
+                grow_pending++;
+                if (free_count == 0) {
+                    filled++;
+                    total_ticks += ticks;
+                    break;
+                }
+                place_apple();
+            }
+        }
+    }
+    printf("%d games on %dx%d: %d filled the board, %.0f ticks to fill on average, %.0f decisions/sec, %.3f ms max\n",
+        games, board_width, board_height, filled, filled ? (double) total_ticks / filled : 0,
+        total_ms > 0 ? decisions / (total_ms / 1e3) : 0, max_ms);
 }
 
 static void update_game() {
-    process_input();
-    move_snake();
+    if (autopilot) current_direction = autopilot_direction();
+    if (!move_snake()) return;
+
+    Position head = snake_head_pos();
+    if (head.x == apple.x && head.y == apple.y) {
+        grow_pending++;
+        place_apple(); 
+    }
+}
+
+static void terminal_size(int *cols, int *rows) {
+    *cols = 80;
+    *rows = 24;
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        *cols = info.srWindow.Right - info.srWindow.Left + 1;
+        *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    }
+#else
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+        *cols = ws.ws_col;
+        *rows = ws.ws_row;
+    }
+#endif
+}
+
+static int footer_lines() {
+    return FOOTER_LINES + (stats_visible ? STATS_OVERLAY_LINES : 0);
+}
+
+static void draw_overlay() {
+    char line[128];
+    for (int i = 0; i < STATS_OVERLAY_LINES; i++) {
+        stats_overlay_line(&stats, i, line, sizeof(line));
+        out_printf(&out, "%s\033[K\n", line);
+    }
+}
+
+// Sizes the viewport to the terminal and scrolls it just far enough to keep
+// the head on screen, so a frame costs the same on any board.
+static void update_viewport(int *view_width, int *view_height) {
+    int cols, rows;
+    terminal_size(&cols, &rows);
+    Position head = snake_head_pos();
+
+    *view_width = (cols - 2) / 2;
+    *view_height = rows - footer_lines() - 2;
+    if (*view_width < 1) *view_width = 1;
+    if (*view_height < 1) *view_height = 1;
+    if (*view_width > board_width) *view_width = board_width;
+    if (*view_height > board_height) *view_height = board_height;
+
+    if (head.x < view_origin.x) view_origin.x = head.x;
+    if (head.x >= view_origin.x + *view_width) view_origin.x = head.x - *view_width + 1;
+    if (head.y < view_origin.y) view_origin.y = head.y;
+    if (head.y >= view_origin.y + *view_height) view_origin.y = head.y - *view_height + 1;
+
+    if (view_origin.x > board_width - *view_width) view_origin.x = board_width - *view_width;
+    if (view_origin.y > board_height - *view_height) view_origin.y = board_height - *view_height;
+    if (view_origin.x < 0) view_origin.x = 0;
+    if (view_origin.y < 0) view_origin.y = 0;
+}
+
+// Grows a snapshot's cells to hold count entries. Only the simulation calls
+// it, on the back slot it owns.
+static int *snapshot_cells(Snapshot *snap, int count) {
+    if (count > snap->cell_capacity) {
+        int *cells = realloc(snap->cells, (size_t) count * sizeof(int));
+        if (!cells) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        snap->cells = cells;
+        snap->cell_capacity = count;
+    }
+    return snap->cells;
+}
+
+static void capture_view(Snapshot *snap) {
+    int view_width, view_height;
+    update_viewport(&view_width, &view_height);
+    int *cells = snapshot_cells(snap, view_width * view_height);
+
+    for (int y = view_origin.y; y < view_origin.y + view_height; y++) {
+        for (int x = view_origin.x; x < view_origin.x + view_width; x++) {
+            *cells++ = is_occupied(y * board_width + x) ? 1 : x == apple.x && y == apple.y ? -1 : 0;
+        }
+    }
+    snap->view_width = view_width;
+    snap->view_height = view_height;
+    snap->follow = 0;
+    snap->length = snake_length;
+}
+
+static void render_frame(const Snapshot *snap) {
+    out_printf(&out, CLEAR_SCREEN);
+
+    out_printf(&out, "┌");
+    for (int x = 0; x < snap->view_width; x++) out_printf(&out, "──");
+    out_printf(&out, "┐\n");
+
+    const int *cell = snap->cells;
+    for (int y = 0; y < snap->view_height; y++) {
+        out_printf(&out, "│");
+        for (int x = 0; x < snap->view_width; x++, cell++) {
+            if (*cell > 0) {
+                out_printf(&out, "\033[32m@\033[0m ");
+            } else if (*cell < 0) {
+                out_printf(&out, "\033[31m#\033[0m ");
+            } else {
+                out_printf(&out, ". ");
+            }
+        }
+        out_printf(&out, "│\n");
+    }
     
-    Position head = snake[snake_head];
-    for (int i = 0; i < snake_length; i++) {
-        if (i == snake_head) continue;
-        if (snake[i].x == head.x && snake[i].y == head.y) {
-            cleanup_terminal();
-            printf("\nGame Over\n");
-            exit(0);
+    out_printf(&out, "└");
+    for (int x = 0; x < snap->view_width; x++) out_printf(&out, "──");
+    out_printf(&out, "┘\n");
+    
+    out_printf(&out, "\nControls: Arrow keys or WASD to move, T for frame stats, Q to quit\n");
+    out_printf(&out, "Snake length: %d  Dropped: %ld  Output: %.1f KB/s\n", snap->length, out.frames_dropped,
+        out.bytes_per_second / 1024);
+    if (autopilot) out_printf(&out, "Autopilot: on");
+    if (snap->stats_visible) {
+        out_printf(&out, "\n");
+        draw_overlay();
+    }
+}
+
+
+// Arena mode: many snakes on one large board. Each snake's body is a ring of
+// cell indexes in its own slice of arena_body, and every other per-snake field
+// lives in a parallel array indexed by snake id. arena_grid holds the whole
+// board: 0 for empty, id + 1 for a snake's body and -(index + 1) for food.
+static int arena_snakes = 0;
+static bool arena_player = false;
+static int *arena_grid = NULL;
+static int *arena_claim = NULL;
+static int *arena_body = NULL;
+static int *arena_tail = NULL;
+static int *arena_length = NULL;
+static int *arena_grow = NULL;
+static int *arena_next = NULL;
+static int *arena_target = NULL;
+static int *arena_target_cell = NULL;
+static uint32_t *arena_rng = NULL;
+static uint8_t *arena_alive = NULL;
+static int *food_cell = NULL;
+static int food_total = 0;
+static uint32_t arena_seed = 1;
+static long arena_tick = 0;
+static long arena_deaths = 0;
+static atomic_int arena_next_chunk;
+static Direction player_heading = DIR_RIGHT;
+
+// Helpers that choose moves alongside the simulation thread, started once with
+// the arena. Each tick bumps arena_generation to wake them, and arena_step
+// waits until arena_busy says all of them have finished their chunks.
+static pthread_t arena_threads[ARENA_MAX_THREADS];
+static int arena_thread_count = 0;
+static pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t arena_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t arena_done = PTHREAD_COND_INITIALIZER;
+static long arena_generation = 0;
+static int arena_busy = 0;
+static bool arena_stop = false;
+
+static inline int arena_head(int id) {
+    return arena_body[id * ARENA_MAX_LENGTH + ((arena_tail[id] + arena_length[id] - 1) & (ARENA_MAX_LENGTH - 1))];
+}
+
+static inline int arena_neck(int id) {
+    if (arena_length[id] < 2) return -1;
+    return arena_body[id * ARENA_MAX_LENGTH + ((arena_tail[id] + arena_length[id] - 2) & (ARENA_MAX_LENGTH - 1))];
+}
+
+static int random_empty_cell() {
+    for (int tries = 0; tries < 64; tries++) {
+        int cell = next_random(&arena_seed) % (uint32_t) cell_count;
+        if (arena_grid[cell] == 0) return cell;
+    }
+    int start = next_random(&arena_seed) % (uint32_t) cell_count;
+    for (int i = 0; i < cell_count; i++) {
+        int cell = (start + i) % cell_count;
+        if (arena_grid[cell] == 0) return cell;
+    }
+    return -1;
+}
+
+static void place_food(int index) {
+    int cell = random_empty_cell();
+    food_cell[index] = cell;
+    if (cell >= 0) arena_grid[cell] = -(index + 1);
+}
+
+// Lays a fresh snake in a straight horizontal run of empty cells, head on
+// the right. Leaves it dead if no room turns up, to be tried again next tick.
+static void spawn_snake(int id) {
+    for (int tries = 0; tries < 64; tries++) {
+        int x = next_random(&arena_seed) % (uint32_t) (board_width - START_LENGTH + 1);
+        int y = next_random(&arena_seed) % (uint32_t) board_height;
+        int first = y * board_width + x;
+        bool clear = true;
+        for (int i = 0; i < START_LENGTH && clear; i++) {
+            if (arena_grid[first + i] != 0) clear = false;
         }
+        if (!clear) continue;
+
+        for (int i = 0; i < START_LENGTH; i++) {
+            arena_body[id * ARENA_MAX_LENGTH + i] = first + i;
+            arena_grid[first + i] = id + 1;
+        }
+        arena_tail[id] = 0;
+        arena_length[id] = START_LENGTH;
+        arena_grow[id] = 0;
+        arena_target[id] = -1;
+        arena_alive[id] = 1;
+        if (arena_player && id == 0) {
+            player_heading = DIR_RIGHT;
+            current_direction = DIR_NONE;
+        }
+        return;
+    }
+}
+
+static void kill_snake(int id) {
+    for (int i = 0; i < arena_length[id]; i++) {
+        arena_grid[arena_body[id * ARENA_MAX_LENGTH + ((arena_tail[id] + i) & (ARENA_MAX_LENGTH - 1))]] = 0;
     }
+    arena_alive[id] = 0;
+    arena_length[id] = 0;
+    arena_deaths++;
+}
+
+static void arena_init(int snakes) {
+    size_t cells = (size_t) cell_count;
+    arena_snakes = snakes;
+    food_total = snakes * ARENA_FOOD_PER_SNAKE;
 
-     if (snake[snake_head].x < 0 || snake[snake_head].x >= BOARD_WIDTH ||
-        snake[snake_head].y < 0 || snake[snake_head].y >= BOARD_HEIGHT) {
-            cleanup_terminal();
-            printf("\nGame Over\n");
-            exit(0);
+    arena_grid = calloc(cells, sizeof(int));
+    arena_claim = calloc(cells, sizeof(int));
+    arena_body = malloc((size_t) snakes * ARENA_MAX_LENGTH * sizeof(int));
+    arena_tail = calloc(snakes, sizeof(int));
+    arena_length = calloc(snakes, sizeof(int));
+    arena_grow = calloc(snakes, sizeof(int));
+    arena_next = calloc(snakes, sizeof(int));
+    arena_target = calloc(snakes, sizeof(int));
+    arena_target_cell = calloc(snakes, sizeof(int));
+    arena_rng = calloc(snakes, sizeof(uint32_t));
+    arena_alive = calloc(snakes, sizeof(uint8_t));
+    food_cell = calloc(food_total, sizeof(int));
+    if (!arena_grid || !arena_claim || !arena_body || !arena_tail || !arena_length || !arena_grow ||
+        !arena_next || !arena_target || !arena_target_cell || !arena_rng || !arena_alive || !food_cell) {
+        fprintf(stderr, "Not enough memory for a %d snake arena\n", snakes);
+        exit(1);
+    }
+
+    for (int id = 0; id < snakes; id++) {
+        arena_rng[id] = ((uint32_t) id + 1) * 2654435761u | 1;
+        spawn_snake(id);
+    }
+    for (int i = 0; i < food_total; i++) {
+        place_food(i);
+    }
+}
+
+static inline int cell_distance(int a, int b) {
+    return abs(a % board_width - b % board_width) + abs(a / board_width - b / board_width);
+}
+
+// Counts the free cells reachable from start, stopping at limit. Small enough
+// to keep its queue on the stack and check it linearly for repeats.
+static int free_space(int start, int limit) {
+    int queue[ARENA_LOOKAHEAD];
+    int count = 0;
+    queue[count++] = start;
+
+    for (int i = 0; i < count && count < limit; i++) {
+        int neighbours[4];
+        neighbour_cells(queue[i], neighbours);
+        for (int n = 0; n < 4 && count < limit; n++) {
+            int cell = neighbours[n];
+            if (cell < 0 || arena_grid[cell] > 0) continue;
+            bool seen = false;
+            for (int j = 0; j < count && !seen; j++) seen = queue[j] == cell;
+            if (!seen) queue[count++] = cell;
         }
+    }
+    return count;
+}
 
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            board[y][x] = '.';
+// Picks an AI snake's next cell from the board as it stood at the start of the
+// tick, or -1 if it is boxed in. It heads for the nearest of a few sampled
+// food items, avoiding moves that leave less room than its own length. Only
+// the snake's own fields are written, so any number of these can run at once.
+static int choose_move(int id) {
+    int head = arena_head(id);
+    int target = arena_target[id];
+    if (target < 0 || food_cell[target] != arena_target_cell[id] || food_cell[target] < 0) {
+        int best = -1;
+        for (int i = 0; i < ARENA_TARGET_SAMPLES; i++) {
+            int index = next_random(&arena_rng[id]) % (uint32_t) food_total;
+            if (food_cell[index] < 0) continue;
+            if (best < 0 || cell_distance(head, food_cell[index]) < cell_distance(head, food_cell[best])) best = index;
         }
+        target = best;
+        arena_target[id] = target;
+        arena_target_cell[id] = target >= 0 ? food_cell[target] : head;
     }
 
-    for (int i = 0; i < snake_length; i++) {
-        board[snake[i].y][snake[i].x] = '@';
+    int need = arena_length[id] < ARENA_LOOKAHEAD ? arena_length[id] : ARENA_LOOKAHEAD;
+    int neighbours[4];
+    int best = -1;
+    long best_score = 0;
+    neighbour_cells(head, neighbours);
+    for (int i = 0; i < 4; i++) {
+        int cell = neighbours[i];
+        if (cell < 0 || arena_grid[cell] > 0) continue;
+        long score = -cell_distance(cell, arena_target_cell[id]);
+        int space = free_space(cell, need);
+        if (space < need) score -= (long) (need - space) * cell_count;
+        if (best < 0 || score > best_score) {
+            best = cell;
+            best_score = score;
+        }
     }
+    return best;
+}
 
-    if (snake[snake_head].x == apple.x && snake[snake_head].y == apple.y) {
-        int tail_index = (snake_head + 1) % snake_length;
-        Position tail_pos = snake[tail_index];
-        
-        snake_length += 1;
-        
-        snake[tail_index] = tail_pos;
-        
-        place_apple(); 
+// The human snake keeps going its current way unless told otherwise, and
+// cannot turn back onto its own neck.
+static int player_move(int id) {
+    int head = arena_head(id);
+    int x = head % board_width, y = head / board_width;
+    if (current_direction != DIR_NONE) player_heading = current_direction;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int next = -1;
+        switch (player_heading) {
+            case DIR_UP: next = y > 0 ? head - board_width : -1; break;
+            case DIR_DOWN: next = y < board_height - 1 ? head + board_width : -1; break;
+            case DIR_LEFT: next = x > 0 ? head - 1 : -1; break;
+            case DIR_RIGHT: case DIR_NONE: next = x < board_width - 1 ? head + 1 : -1; break;
+        }
+        if (next < 0 || next != arena_neck(id)) return next;
+        player_heading = player_heading == DIR_UP ? DIR_DOWN : player_heading == DIR_DOWN ? DIR_UP :
+            player_heading == DIR_LEFT ? DIR_RIGHT : DIR_LEFT;
     }
-    
-    board[apple.y][apple.x] = '#';  
+    return -1;
 }
 
-static void render_frame() {
-    system(CLEAR_CMD);
-  
-    printf("┌");
-    for (int x = 0; x < BOARD_WIDTH; x++) printf("──");
-    printf("┐\n");
-
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        printf("│");
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            if (board[y][x] == '@') {
-                printf("\033[32m@\033[0m ");
-            } else if (board[y][x] == '#') {
-                printf("\033[31m#\033[0m ");
-            } else {
-                printf("%c ", board[y][x]);
+static int worker_thread_count() {
+#ifndef _WIN32
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    long count = 4;
+#endif
+    if (count < 1) count = 1;
+    if (count > ARENA_MAX_THREADS) count = ARENA_MAX_THREADS;
+    return (int) count;
+}
+
+static void decide_moves() {
+    int chunk;
+    while ((chunk = atomic_fetch_add(&arena_next_chunk, 1)) * ARENA_CHUNK < arena_snakes) {
+        int end = (chunk + 1) * ARENA_CHUNK;
+        if (end > arena_snakes) end = arena_snakes;
+        for (int id = chunk * ARENA_CHUNK; id < end; id++) {
+            if (!arena_alive[id] || (arena_player && id == 0)) continue;
+            arena_next[id] = choose_move(id);
+        }
+    }
+}
+
+static void *decide_worker(void *arg) {
+    (void) arg;
+    long seen = 0;
+    pthread_mutex_lock(&arena_lock);
+    while (true) {
+        while (arena_generation == seen && !arena_stop) pthread_cond_wait(&arena_work, &arena_lock);
+        if (arena_stop) break;
+        seen = arena_generation;
+        pthread_mutex_unlock(&arena_lock);
+
+        decide_moves();
+
+        pthread_mutex_lock(&arena_lock);
+        if (--arena_busy == 0) pthread_cond_signal(&arena_done);
+    }
+    pthread_mutex_unlock(&arena_lock);
+    return NULL;
+}
+
+// Starts as many helpers as the machine has spare cores. If none start, the
+// simulation thread chooses every move itself.
+static void start_arena_workers() {
+    int helpers = worker_thread_count() - 1;
+    while (arena_thread_count < helpers &&
+        pthread_create(&arena_threads[arena_thread_count], NULL, decide_worker, NULL) == 0) {
+        arena_thread_count++;
+    }
+}
+
+static void stop_arena_workers() {
+    pthread_mutex_lock(&arena_lock);
+    arena_stop = true;
+    pthread_cond_broadcast(&arena_work);
+    pthread_mutex_unlock(&arena_lock);
+    for (int i = 0; i < arena_thread_count; i++) pthread_join(arena_threads[i], NULL);
+    arena_thread_count = 0;
+}
+
+// Every snake's move is chosen in parallel against the same snapshot of the
+// board. The merge that follows runs on one thread in id order, so a tick's
+// outcome never depends on how the work was split.
+static void arena_step() {
+    atomic_store(&arena_next_chunk, 0);
+    pthread_mutex_lock(&arena_lock);
+    arena_busy = arena_thread_count;
+    arena_generation++;
+    pthread_cond_broadcast(&arena_work);
+    pthread_mutex_unlock(&arena_lock);
+
+    decide_moves();
+
+    pthread_mutex_lock(&arena_lock);
+    while (arena_busy > 0) pthread_cond_wait(&arena_done, &arena_lock);
+    pthread_mutex_unlock(&arena_lock);
+    if (arena_player && arena_alive[0]) arena_next[0] = player_move(0);
+
+    // Two heads entering the same cell both die.
+    for (int id = 0; id < arena_snakes; id++) {
+        int next = arena_next[id];
+        if (!arena_alive[id] || next < 0) continue;
+        arena_claim[next] = arena_claim[next] == 0 ? id + 1 : -1;
+    }
+
+    // Tails leave before anyone moves in, so a snake may chase any tail that
+    // is not growing this tick.
+    for (int id = 0; id < arena_snakes; id++) {
+        if (!arena_alive[id]) continue;
+        if (arena_grow[id] > 0) {
+            arena_grow[id]--;
+        } else {
+            arena_grid[arena_body[id * ARENA_MAX_LENGTH + arena_tail[id]]] = 0;
+            arena_tail[id] = (arena_tail[id] + 1) & (ARENA_MAX_LENGTH - 1);
+            arena_length[id]--;
+        }
+    }
+
+    for (int id = 0; id < arena_snakes; id++) {
+        int next = arena_next[id];
+        if (!arena_alive[id]) continue;
+        if (next < 0 || arena_claim[next] < 0 || arena_grid[next] > 0) arena_alive[id] = 2;
+    }
+    for (int id = 0; id < arena_snakes; id++) {
+        if (arena_alive[id] == 2) kill_snake(id);
+    }
+
+    for (int id = 0; id < arena_snakes; id++) {
+        int next = arena_next[id];
+        if (!arena_alive[id]) continue;
+        arena_claim[next] = 0;
+
+        int food = arena_grid[next];
+        if (food < 0) {
+            food_cell[-food - 1] = -1;
+            if (arena_length[id] + arena_grow[id] < ARENA_MAX_LENGTH) arena_grow[id]++;
+        }
+        arena_body[id * ARENA_MAX_LENGTH + ((arena_tail[id] + arena_length[id]) & (ARENA_MAX_LENGTH - 1))] = next;
+        arena_length[id]++;
+        arena_grid[next] = id + 1;
+    }
+    for (int id = 0; id < arena_snakes; id++) {
+        if (arena_next[id] >= 0) arena_claim[arena_next[id]] = 0;
+        arena_next[id] = -1;
+    }
+
+    for (int i = 0; i < food_total; i++) {
+        if (food_cell[i] < 0) place_food(i);
+    }
+    for (int id = 0; id < arena_snakes; id++) {
+        if (!arena_alive[id]) spawn_snake(id);
+    }
+    arena_tick++;
+}
+
+static void frame_append(const char *text) {
+    out_append(&out, text, strlen(text));
+}
+
+// Copies a terminal-sized window centred on the followed snake.
+static void capture_arena(Snapshot *snap) {
+    int cols, rows;
+    terminal_size(&cols, &rows);
+    int view_width = (cols - 2) / 2, view_height = rows - footer_lines() - 2;
+    if (view_width < 1) view_width = 1;
+    if (view_height < 1) view_height = 1;
+    if (view_width > board_width) view_width = board_width;
+    if (view_height > board_height) view_height = board_height;
+
+    int follow = ((arena_follow % arena_snakes) + arena_snakes) % arena_snakes;
+    arena_follow = follow;
+    if (arena_alive[follow]) {
+        int head = arena_head(follow);
+        view_origin.x = head % board_width - view_width / 2;
+        view_origin.y = head / board_width - view_height / 2;
+    }
+    if (view_origin.x > board_width - view_width) view_origin.x = board_width - view_width;
+    if (view_origin.y > board_height - view_height) view_origin.y = board_height - view_height;
+    if (view_origin.x < 0) view_origin.x = 0;
+    if (view_origin.y < 0) view_origin.y = 0;
+
+    int *cells = snapshot_cells(snap, view_width * view_height);
+    for (int y = view_origin.y; y < view_origin.y + view_height; y++) {
+        memcpy(cells, arena_grid + y * board_width + view_origin.x, (size_t) view_width * sizeof(int));
+        cells += view_width;
+    }
+
+    int alive = 0;
+    for (int id = 0; id < arena_snakes; id++) alive += arena_alive[id];
+    snap->view_width = view_width;
+    snap->view_height = view_height;
+    snap->follow = follow;
+    snap->length = arena_length[follow];
+    snap->alive = alive;
+    snap->deaths = arena_deaths;
+}
+
+// Draws the window as one frame over the previous one, since clearing the
+// screen sixty times a second flickers. Colour codes are only emitted when
+// the colour changes.
+static void render_arena(const Snapshot *snap) {
+    static const char *palette[] = {"\033[33m", "\033[34m", "\033[35m", "\033[36m"};
+    char line[256];
+    frame_append("\033[H\033[0m┌");
+    for (int x = 0; x < snap->view_width; x++) frame_append("──");
+    frame_append("┐\n");
+
+    const int *cell = snap->cells;
+    for (int y = 0; y < snap->view_height; y++) {
+        const char *colour = "";
+        frame_append("│");
+        for (int x = 0; x < snap->view_width; x++, cell++) {
+            int value = *cell;
+            const char *want = value > 0 ? (value - 1 == snap->follow ? "\033[32m" : palette[(value - 1) % 4]) :
+                value < 0 ? "\033[31m" : "\033[0m";
+            if (want != colour) {
+                frame_append(want);
+                colour = want;
             }
+            frame_append(value > 0 ? "@ " : value < 0 ? "# " : ". ");
         }
-        printf("│\n");
+        frame_append("\033[0m│\n");
     }
-    
-    printf("└");
-    for (int x = 0; x < BOARD_WIDTH; x++) printf("──");
-    printf("┘\n");
-    
-    printf("\nControls: Arrow keys or WASD to move, Q to quit\n");
-    printf("Snake length: %d", snake_length);
+
+    frame_append("└");
+    for (int x = 0; x < snap->view_width; x++) frame_append("──");
+    frame_append("┘\n");
+
+    snprintf(line, sizeof(line), "\nControls: %s[ and ] to switch snake, T for frame stats, Q to quit\033[K\n",
+        arena_player ? "Arrow keys or WASD to steer snake 0, " : "");
+    frame_append(line);
+    snprintf(line, sizeof(line), "Following snake %d, length %d | %d of %d alive, %ld deaths, tick %ld\033[K\n",
+        snap->follow, snap->length, snap->alive, arena_snakes, snap->deaths, snap->info.sequence);
+    frame_append(line);
+    snprintf(line, sizeof(line), "Step %.2f ms, %.1f ticks/sec, %ld frames dropped, %.1f KB/s\033[K",
+        snap->step_ms, snap->ticks_per_second, out.frames_dropped, out.bytes_per_second / 1024);
+    frame_append(line);
+    if (snap->stats_visible) {
+        frame_append("\n");
+        draw_overlay();
+    }
+    frame_append("\033[J");
+}
+
+static void publish_snapshot(long tick, long input_ns, long update_ns, double ticks_per_second) {
+    Snapshot *snap = triple_back(&snapshots);
+    snap->info.sequence = tick;
+    snap->info.input_ns = input_ns;
+    snap->info.update_ns = update_ns;
+    snap->step_ms = (input_ns + update_ns) / 1e6;
+    snap->ticks_per_second = ticks_per_second;
+    snap->stats_visible = stats_visible;
+    if (arena_snakes > 0) {
+        capture_arena(snap);
+    } else {
+        capture_view(snap);
+    }
+    triple_publish(&snapshots);
+}
+
+// Runs the classic game or the arena, whichever was set up, until a key, a
+// collision or a full board stops it. A tick that ends the game publishes
+// nothing, so the last frame drawn is the last position played.
+static void *simulation_thread(void *arg) {
+    (void) arg;
+    long tick_us = arena_snakes > 0 ? 1000000 / ARENA_TICK_RATE : MICROSECONDS_PER_TICK;
+    double ticks_per_second = 0;
+    long tick = 0;
+    struct timespec deadline, last;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    last = deadline;
+
+    while (atomic_load(&running)) {
+        long long tick_start = stats_now_ns();
+        process_input();
+        long long input_done = stats_now_ns();
+        if (arena_snakes > 0) {
+            arena_step();
+        } else {
+            update_game();
+        }
+        if (!atomic_load(&running)) break;
+        tick++;
+        publish_snapshot(tick, input_done - tick_start, stats_now_ns() - input_done, ticks_per_second);
+        loop_wait_for_tick(&deadline, tick_us);
+
+        double tick_ms = elapsed_ms(last);
+        clock_gettime(CLOCK_MONOTONIC, &last);
+        ticks_per_second = tick_ms > 0 ? 1000 / tick_ms : 0;
+    }
+    return NULL;
 }
 
+static void draw_snapshot(const void *snapshot) {
+    if (arena_snakes > 0) {
+        render_arena(snapshot);
+    } else {
+        render_frame(snapshot);
+    }
+}
+
+static RenderLoop render_loop = {&snapshots, &out, &stats, &running, draw_snapshot};
+
+// Plays the game on a simulation thread and a render thread, then restores
+// the terminal and reports how it ended.
+static int run_game() {
+    out_init(&out, STDOUT_FILENO);
+    if (arena_snakes > 0) out_printf(&out, CLEAR_SCREEN);
+    triple_init(&snapshots, snapshot_slots, sizeof(Snapshot));
+
+    pthread_t simulation, renderer;
+    bool simulating = pthread_create(&simulation, NULL, simulation_thread, NULL) == 0;
+    bool rendering = simulating && pthread_create(&renderer, NULL, render_loop_thread, &render_loop) == 0;
+    if (!rendering) atomic_store(&running, false);
+    if (simulating) pthread_join(simulation, NULL);
+    if (rendering) pthread_join(renderer, NULL);
+    out_close(&out);
+    stats_close(&stats);
+
+    cleanup_terminal();
+    if (!rendering) {
+        fprintf(stderr, "Could not start the game threads\n");
+        return 1;
+    }
+    printf("%s", end_message);
+    return 0;
+}
+
+static void run_arena_bench(int ticks) {
+    double total_ms = 0, max_ms = 0;
+    for (int i = 0; i < ticks; i++) {
+        struct timespec begin;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        arena_step();
+        double ms = elapsed_ms(begin);
+        total_ms += ms;
+        if (ms > max_ms) max_ms = ms;
+    }
+    printf("%d ticks with %d snakes on %dx%d using %d threads: %.3f ms/tick avg, %.3f ms max, %.0f ticks/sec, %ld deaths\n",
+        ticks, arena_snakes, board_width, board_height, arena_thread_count + 1,
+        total_ms / ticks, max_ms, total_ms > 0 ? ticks / (total_ms / 1e3) : 0, arena_deaths);
+}
+
+int main(int argc, char *argv[]) {
+    int bench_games = 0, bench_ticks = 0;
+    bool size_given = false;
+    const char *stats_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            board_width = atoi(argv[++i]);
+            size_given = true;
+        } else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+            board_height = atoi(argv[++i]);
+            size_given = true;
+        } else if (strcmp(argv[i], "--arena") == 0 && i + 1 < argc) {
+            arena_snakes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--arena-bench") == 0 && i + 1 < argc) {
+            bench_ticks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--arena-player") == 0) {
+            arena_player = true;
+        } else if (strcmp(argv[i], "--follow") == 0 && i + 1 < argc) {
+            arena_follow = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--autopilot") == 0) {
+            autopilot = true;
+        } else if (strcmp(argv[i], "--autopilot-bench") == 0 && i + 1 < argc) {
+            bench_games = atoi(argv[++i]);
+            autopilot = true;
+        } else if (strcmp(argv[i], "--stats-file") == 0 && i + 1 < argc) {
+            stats_path = argv[++i];
+        }
+    }
+    if (!stats_open(&stats, stats_path)) {
+        printf("Could not open %s for writing\n", stats_path);
+        return 1;
+    }
+    atomic_init(&running, true);
+    if (arena_snakes > 0) {
+        if (!size_given) board_width = board_height = ARENA_DEFAULT_DIM;
+        if (board_width < MIN_BOARD_DIM || board_width > ARENA_MAX_DIM ||
+            board_height < MIN_BOARD_DIM || board_height > ARENA_MAX_DIM) {
+            printf("Arena dimensions must be between %d and %d\n", MIN_BOARD_DIM, ARENA_MAX_DIM);
+            return 1;
+        }
+        cell_count = board_width * board_height;
+        if (arena_snakes > ARENA_MAX_SNAKES || arena_snakes > cell_count / 16) {
+            printf("Too many snakes for a %dx%d arena\n", board_width, board_height);
+            return 1;
+        }
+        arena_seed = bench_ticks > 0 ? 0x9E3779B9u : (uint32_t) time(NULL) | 1;
+        arena_init(arena_snakes);
+        start_arena_workers();
+        if (bench_ticks > 0) {
+            run_arena_bench(bench_ticks);
+            stop_arena_workers();
+            return 0;
+        }
+        setup_terminal();
+        int result = run_game();
+        stop_arena_workers();
+        return result;
+    }
+
+    if (board_width < MIN_BOARD_DIM || board_width > MAX_BOARD_DIM ||
+        board_height < MIN_BOARD_DIM || board_height > MAX_BOARD_DIM) {
+        printf("Board dimensions must be between %d and %d\n", MIN_BOARD_DIM, MAX_BOARD_DIM);
+        return 1;
+    }
+    cell_count = board_width * board_height;
+    init_board();
+    if (autopilot && !build_cycle()) {
+        printf("The autopilot needs an even width or height\n");
+        return 1;
+    }
+    if (bench_games > 0) {
+        run_autopilot_bench(bench_games);
+        return 0;
+    }
 
-int main() {
     printf("Starting terminal snake game...\n");
     printf("Setting up terminal for raw input...\n");
     
-    srand(time(NULL));  
+    rng_state = (uint32_t) time(NULL) | 1;
     setup_terminal();
     init_snake();  
     place_apple();      
-
-    while (true) {
-        update_game();
-        render_frame();
-        usleep(MICROSECONDS_PER_TICK);
-    }
-    
-    cleanup_terminal();
-    return 0;
+    return run_game();
 }
\ No newline at end of file
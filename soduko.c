@@ -4,18 +4,41 @@
 #include <unistd.h>
 #include <time.h> 
 #include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "dlx.h"
+#include "term_output.h"
+#include "frame_stats.h"
 #ifdef _WIN32
     #include <conio.h>
     #include <windows.h>
-    #define CLEAR_CMD "cls"
 #else 
     #include <termios.h>
     #include <fcntl.h>
-    #define CLEAR_CMD "clear"
+    #include <sys/mman.h>
+    #include <sys/stat.h>
 #endif 
 
-#define BOARD_WIDTH 9
-#define BOARD_HEIGHT 9
+#define MAX_BOARD_SIZE 25
+#define MAX_CELLS (MAX_BOARD_SIZE * MAX_BOARD_SIZE)
+#define MAX_UNITS (3 * MAX_BOARD_SIZE)
+#define DLX_COLUMNS (4 * MAX_CELLS)
+#define DLX_ROWS (MAX_CELLS * MAX_BOARD_SIZE)
+#define DLX_NODES (1 + DLX_COLUMNS + 4 * DLX_ROWS)
+#define SEARCH_BUDGET 2000
+#define CLEAR_SCREEN "\033[H\033[2J"
+#define MAX_GEN_ATTEMPTS 20
+#define BENCH_REPEATS 200
+#define POOL_SIZE 8
+#define BATCH_CHUNK_BYTES (64 * 1024)
+#define MAX_SEED_PUZZLES 32
+#define LINE_ORDERS (6 * 6 * 6 * 6)
+#define BANK_MAGIC "SDKBANK1"
+#define BANK_MAX_SIZE 16
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
 #define TICK_RATE 60
 #define MICROSECONDS_PER_TICK (1000000 / TICK_RATE)
 
@@ -30,8 +53,117 @@ typedef struct {
     bool preloaded; 
 } Square; 
 
-Square board[BOARD_HEIGHT][BOARD_WIDTH];
-Position player_pos = {BOARD_HEIGHT / 2, BOARD_WIDTH / 2};
+typedef enum {
+    DIFFICULTY_EASY, DIFFICULTY_MEDIUM, DIFFICULTY_HARD, DIFFICULTY_COUNT
+} Difficulty;
+
+typedef struct {
+    unsigned char givens[MAX_CELLS];
+    unsigned char solution[MAX_CELLS];
+    Difficulty difficulty;
+} Puzzle;
+
+typedef struct {
+    const char *givens;
+    Difficulty difficulty;
+} SeedPuzzle;
+
+typedef enum {
+    BATCH_SOLVE, BATCH_CHECK, BATCH_CANON
+} BatchMode;
+
+// On-disk bank: this header, then fixed-size records grouped by difficulty.
+// A record is the solution as one nibble per cell (value - 1) followed by a
+// bitmap of which cells are givens.
+typedef struct {
+    char magic[8];
+    uint32_t board_size;
+    uint32_t record_size;
+    uint32_t counts[DIFFICULTY_COUNT];
+    uint32_t reserved;
+    uint64_t offsets[DIFFICULTY_COUNT];
+    uint64_t checksum;
+} BankHeader;
+
+typedef struct {
+    Puzzle slots[POOL_SIZE];
+    atomic_uint head;
+    atomic_uint tail;
+} PuzzleQueue;
+
+typedef struct {
+    unsigned char cells[MAX_CELLS];
+    uint32_t row_used[MAX_BOARD_SIZE];
+    uint32_t col_used[MAX_BOARD_SIZE];
+    uint32_t box_used[MAX_BOARD_SIZE];
+    int empty;
+} SolverGrid;
+
+Square board[MAX_BOARD_SIZE][MAX_BOARD_SIZE];
+int board_size = 9;
+int box_size = 3;
+int cell_count = 81;
+int unit_count = 27;
+uint32_t all_digits = 0x1ff;
+int units[MAX_UNITS][MAX_BOARD_SIZE];
+DlxNode dlx_nodes[DLX_NODES];
+int dlx_sizes[DLX_COLUMNS + 1];
+int dlx_stack[MAX_CELLS];
+Dlx sudoku_dlx;
+PuzzleQueue puzzle_pool[DIFFICULTY_COUNT];
+atomic_int target_difficulty = DIFFICULTY_MEDIUM;
+atomic_bool generator_running = false;
+pthread_t generator_thread;
+uint32_t ui_seed = 1;
+Difficulty board_difficulty = DIFFICULTY_MEDIUM;
+const char *difficulty_names[] = {"Easy", "Medium", "Hard"};
+int row_counts[MAX_BOARD_SIZE][MAX_BOARD_SIZE + 1];
+int col_counts[MAX_BOARD_SIZE][MAX_BOARD_SIZE + 1];
+int box_counts[MAX_BOARD_SIZE][MAX_BOARD_SIZE + 1];
+uint32_t row_present[MAX_BOARD_SIZE];
+uint32_t col_present[MAX_BOARD_SIZE];
+uint32_t box_present[MAX_BOARD_SIZE];
+int filled_cells = 0;
+int conflict_units = 0;
+bool show_candidates = false;
+static TermOutput out;
+static FrameStats stats;
+static bool stats_visible = false;
+
+const unsigned char *bank_data = NULL;
+size_t bank_size = 0;
+Puzzle seed_bank[MAX_SEED_PUZZLES];
+int seed_bank_count = 0;
+
+const SeedPuzzle seed_puzzles[] = {
+    {"010400000004007600800960052000000090000802045120040078600070000000000000070000580", DIFFICULTY_EASY},
+    {"025308000040100000108005043000060004200080000009007000000000061604030007073009005", DIFFICULTY_EASY},
+    {"370004109084000000000005007050000000006000790430280000108072060063010000900000005", DIFFICULTY_EASY},
+    {"005030008060180000040007520650009207007000000908200300020090030000001005000050060", DIFFICULTY_EASY},
+    {"240000000500009001080105000000960003100000900600000000003020500004300270000080090", DIFFICULTY_MEDIUM},
+    {"700000030020080005010000000009064078400030900160007002600000007900200000000090006", DIFFICULTY_MEDIUM},
+    {"300000000025090070807001000000000500001800020700200400000480007060010304400002080", DIFFICULTY_MEDIUM},
+    {"000089700056000004030000000390000578805001000000000060470008300000970001500000400", DIFFICULTY_MEDIUM},
+    {"009170003060000900030050000090000080000200300540700600000000160400000000680004005", DIFFICULTY_HARD},
+    {"004060007000100080050070100043500870000000000000017200130009000076000042000030000", DIFFICULTY_HARD},
+    {"020090040430005006000000500089000002000070000500030004008003000150040000006020089", DIFFICULTY_HARD},
+    {"000008002009000038500013000403100000000970050000004200080300940005047000200000060", DIFFICULTY_HARD},
+};
+
+const int perms3[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+int line_orders[LINE_ORDERS][9];
+
+const char *bench_puzzles[] = {
+    "000000010400000000020000000000050407008000300001090000300400200050100000000806000",
+    "000000010400000000020000000000050604008000300001090000300400200050100000000807000",
+    "000000012000035000000600070700000300000400800100000000000120000080000040050000600",
+    "000000012003600000000007000410020000000500300700000600280000040000300500000000000",
+    "000000012008030000000000040120500000000004700060000000507000300000620000000100000",
+    "000000013000030080070000000000206000030000900000010000600500204000400700100000000",
+    "000000013000200000000000080000760200008000400010000000200000750600340000000008000",
+    "000000013000500070000802000000400900107000000000000200890000050040000600000010000",
+};
+Position player_pos = {0, 0};
 Position last_player_pos = {-1, -1};
 bool board_changed = true;
 
@@ -88,277 +220,984 @@ static char read_char() {
 #endif
 
 static void bounds_check() {
-    if (player_pos.x >= BOARD_WIDTH) {
-        player_pos.x = BOARD_WIDTH -1;
+    if (player_pos.x >= board_size) {
+        player_pos.x = board_size -1;
     } else if (player_pos.x < 0) {
         player_pos.x = 0;
     }
-    if (player_pos.y >= BOARD_HEIGHT) {
-        player_pos.y = BOARD_HEIGHT - 1;
+    if (player_pos.y >= board_size) {
+        player_pos.y = board_size - 1;
     } else if (player_pos.y < 0) {
         player_pos.y = 0;
     }
 }
 
-static bool is_valid_pos(int num, int row, int col) {
-    for (int x = 0; x < BOARD_WIDTH; x++) {
-        if (x != col && board[row][x].real_num == num) {
-            return false;
+static int box_of(int row, int col) {
+    return (row / box_size) * box_size + col / box_size;
+}
+
+static void init_units() {
+    for (int i = 0; i < board_size; i++) {
+        for (int j = 0; j < board_size; j++) {
+            units[i][j] = i * board_size + j;
+            units[board_size + i][j] = j * board_size + i;
+            int row = (i / box_size) * box_size + j / box_size;
+            int col = (i % box_size) * box_size + j % box_size;
+            units[2 * board_size + i][j] = row * board_size + col;
         }
     }
+}
+
+static bool set_board_size(int size) {
+    int box = 2;
+    while (box * box < size) box++;
+    if (box * box != size || size > MAX_BOARD_SIZE) return false;
 
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        if (y != row && board[y][col].real_num == num) {
+    board_size = size;
+    box_size = box;
+    cell_count = size * size;
+    unit_count = 3 * size;
+    all_digits = (1u << size) - 1;
+    init_units();
+    return true;
+}
+
+static char num_symbol(int num) {
+    return (num <= 9) ? '0' + num : 'A' + num - 10;
+}
+
+static int symbol_num(int key) {
+    if (key >= '1' && key <= '9') return key - '0';
+    if (key >= 'A' && key <= 'Z') return key - 'A' + 10;
+    return 0;
+}
+
+static bool parse_puzzle(const char *text, int length, unsigned char givens[MAX_CELLS]) {
+    if (length != cell_count) return false;
+    for (int cell = 0; cell < cell_count; cell++) {
+        char c = text[cell];
+        int num = (c == '.' || c == '0') ? 0 : symbol_num(c);
+        if (num > board_size || (num == 0 && c != '.' && c != '0')) return false;
+        givens[cell] = num;
+    }
+    return true;
+}
+
+static uint32_t solver_candidates(const SolverGrid *grid, int cell) {
+    int row = cell / board_size;
+    int col = cell % board_size;
+    return all_digits & ~(grid->row_used[row] | grid->col_used[col] | grid->box_used[box_of(row, col)]);
+}
+
+static bool solver_place(SolverGrid *grid, int cell, int num) {
+    int row = cell / board_size;
+    int col = cell % board_size;
+    int box = box_of(row, col);
+    uint32_t bit = 1 << (num - 1);
+
+    if ((grid->row_used[row] | grid->col_used[col] | grid->box_used[box]) & bit) {
+        return false;
+    }
+    grid->cells[cell] = num;
+    grid->row_used[row] |= bit;
+    grid->col_used[col] |= bit;
+    grid->box_used[box] |= bit;
+    grid->empty--;
+    return true;
+}
+
+static bool solver_load(SolverGrid *grid, const unsigned char givens[MAX_CELLS]) {
+    memset(grid, 0, sizeof(*grid));
+    grid->empty = cell_count;
+    for (int cell = 0; cell < cell_count; cell++) {
+        if (givens[cell] != 0 && !solver_place(grid, cell, givens[cell])) {
             return false;
         }
     }
+    return true;
+}
+
+// Candidates for a whole row at once: the row mask is constant and the box
+// masks are expanded per column so the inner loop is a straight vector OR.
+static void solver_row_candidates(const SolverGrid *grid, int row, uint32_t *out) {
+    uint32_t box_masks[MAX_BOARD_SIZE];
+    uint32_t row_mask = grid->row_used[row];
+    int band = (row / box_size) * box_size;
 
-    int box_start_row = (row / 3) * 3;
-    int box_start_col = (col / 3) * 3;
-    for (int y = box_start_row; y < box_start_row + 3; y++) {
-        for (int x = box_start_col; x < box_start_col + 3; x++) {
-            if ((y != row || x != col) && board[y][x].real_num == num) {
-                return false;
+    for (int col = 0; col < board_size; col++) {
+        box_masks[col] = grid->box_used[band + col / box_size];
+    }
+    for (int col = 0; col < board_size; col++) {
+        out[col] = all_digits & ~(row_mask | grid->col_used[col] | box_masks[col]);
+    }
+}
+
+static int solver_naked_singles(SolverGrid *grid) {
+    int placed = 0;
+    uint32_t candidates[MAX_BOARD_SIZE];
+
+    for (int row = 0; row < board_size; row++) {
+        solver_row_candidates(grid, row, candidates);
+        for (int col = 0; col < board_size; col++) {
+            int cell = row * board_size + col;
+            if (grid->cells[cell] != 0) continue;
+            if (candidates[col] == 0) return -1;
+            if ((candidates[col] & (candidates[col] - 1)) == 0) {
+                if (!solver_place(grid, cell, __builtin_ctz(candidates[col]) + 1)) return -1;
+                placed++;
             }
         }
     }
+    return placed;
+}
+
+static int solver_hidden_singles(SolverGrid *grid) {
+    int placed_count = 0;
+    for (int unit = 0; unit < unit_count; unit++) {
+        uint32_t seen_once = 0, seen_twice = 0, placed = 0;
+        for (int i = 0; i < board_size; i++) {
+            int cell = units[unit][i];
+            if (grid->cells[cell] != 0) {
+                placed |= 1 << (grid->cells[cell] - 1);
+                continue;
+            }
+            uint32_t candidates = solver_candidates(grid, cell);
+            seen_twice |= seen_once & candidates;
+            seen_once |= candidates;
+        }
+        if ((seen_once | placed) != all_digits) return -1;
+
+        uint32_t hidden = seen_once & ~seen_twice & ~placed;
+        for (int i = 0; i < board_size && hidden; i++) {
+            int cell = units[unit][i];
+            if (grid->cells[cell] != 0) continue;
+            uint32_t single = solver_candidates(grid, cell) & hidden;
+            if (single == 0) continue;
+            if (single & (single - 1)) return -1;
+            if (!solver_place(grid, cell, __builtin_ctz(single) + 1)) return -1;
+            hidden &= ~single;
+            placed_count++;
+        }
+    }
+    return placed_count;
+}
+
+static bool solver_propagate(SolverGrid *grid) {
+    while (grid->empty > 0) {
+        int placed = solver_naked_singles(grid);
+        if (placed < 0) return false;
+        if (placed > 0) continue;
+
+        placed = solver_hidden_singles(grid);
+        if (placed < 0) return false;
+        if (placed == 0) break;
+    }
     return true;
 }
 
-static int count_solutions(int row, int col, int limit) {
-    if (row == BOARD_HEIGHT) return 1;
-    
-    int next_row = (col == BOARD_WIDTH - 1) ? row + 1 : row;
-    int next_col = (col == BOARD_WIDTH - 1) ? 0 : col + 1;
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
 
-    if (board[row][col].player_num != 0) {
-        return count_solutions(next_row, next_col, limit);
+static void shuffle(int *values, int count, uint32_t *seed) {
+    for (int i = count - 1; i > 0; i--) {
+        int j = next_random(seed) % (i + 1);
+        int temp = values[i];
+        values[i] = values[j];
+        values[j] = temp;
     }
-    
-    int solutions = 0;
-    for (int num = 1; num <= 9; num++) {
-        bool valid = true;
-        
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            if (x != col && board[row][x].player_num == num) {
-                valid = false;
-                break;
-            }
+}
+
+// A budget bounds the number of search nodes; once it runs out the search
+// reports limit solutions so callers treat the puzzle as not proven unique.
+static int solver_search(SolverGrid *grid, int limit, unsigned char *solution, uint32_t *seed, int *budget) {
+    if (budget && --*budget < 0) return limit;
+    if (!solver_propagate(grid)) return 0;
+    if (grid->empty == 0) {
+        if (solution) memcpy(solution, grid->cells, cell_count);
+        return 1;
+    }
+
+    int best_cell = -1;
+    int best_count = board_size + 1;
+    for (int cell = 0; cell < cell_count && best_count > 2; cell++) {
+        if (grid->cells[cell] != 0) continue;
+        int count = __builtin_popcount(solver_candidates(grid, cell));
+        if (count < best_count) {
+            best_count = count;
+            best_cell = cell;
         }
-        
-        if (valid) {
-            for (int y = 0; y < BOARD_HEIGHT; y++) {
-                if (y != row && board[y][col].player_num == num) {
-                    valid = false;
-                    break;
-                }
+    }
+
+    int nums[MAX_BOARD_SIZE];
+    int num_count = 0;
+    uint32_t candidates = solver_candidates(grid, best_cell);
+    while (candidates) {
+        nums[num_count++] = __builtin_ctz(candidates) + 1;
+        candidates &= candidates - 1;
+    }
+    if (seed) shuffle(nums, num_count, seed);
+
+    int solutions = 0;
+    for (int i = 0; i < num_count && solutions < limit; i++) {
+        SolverGrid next = *grid;
+        solver_place(&next, best_cell, nums[i]);
+        solutions += solver_search(&next, limit - solutions, solutions == 0 ? solution : NULL, seed, budget);
+    }
+    return solutions;
+}
+
+static int count_solutions(const unsigned char givens[MAX_CELLS], int limit) {
+    SolverGrid grid;
+    if (!solver_load(&grid, givens)) return 0;
+    return solver_search(&grid, limit, NULL, NULL, NULL);
+}
+
+static int count_solutions_bounded(const unsigned char givens[MAX_CELLS], int limit, int budget) {
+    SolverGrid grid;
+    if (!solver_load(&grid, givens)) return 0;
+    return solver_search(&grid, limit, NULL, NULL, &budget);
+}
+
+static Difficulty grade_puzzle(const unsigned char givens[MAX_CELLS]) {
+    SolverGrid grid;
+    if (!solver_load(&grid, givens)) return DIFFICULTY_HARD;
+
+    Difficulty difficulty = DIFFICULTY_EASY;
+    while (grid.empty > 0) {
+        int placed = solver_naked_singles(&grid);
+        if (placed > 0) continue;
+        if (placed == 0) {
+            placed = solver_hidden_singles(&grid);
+            if (placed > 0) {
+                difficulty = DIFFICULTY_MEDIUM;
+                continue;
             }
         }
-        
-        if (valid) {
-            int box_start_row = (row / 3) * 3;
-            int box_start_col = (col / 3) * 3;
-            for (int y = box_start_row; y < box_start_row + 3; y++) {
-                for (int x = box_start_col; x < box_start_col + 3; x++) {
-                    if ((y != row || x != col) && board[y][x].player_num == num) {
-                        valid = false;
-                        break;
-                    }
-                }
-                if (!valid) break;
+        return DIFFICULTY_HARD;
+    }
+    return difficulty;
+}
+
+static void dlx_load_board(const unsigned char givens[MAX_CELLS]) {
+    dlx_init(&sudoku_dlx, dlx_nodes, DLX_NODES, dlx_sizes, 4 * cell_count, dlx_stack);
+
+    for (int y = 0; y < board_size; y++) {
+        for (int x = 0; x < board_size; x++) {
+            int cell = y * board_size + x;
+            int given = givens[cell];
+
+            for (int num = 1; num <= board_size; num++) {
+                if (given != 0 && num != given) continue;
+
+                int columns[4] = {
+                    cell,
+                    cell_count + y * board_size + num - 1,
+                    2 * cell_count + x * board_size + num - 1,
+                    3 * cell_count + box_of(y, x) * board_size + num - 1
+                };
+                dlx_add_row(&sudoku_dlx, cell * board_size + num - 1, columns, 4);
             }
         }
-        
-        if (valid) {
-            board[row][col].player_num = num;
-            solutions += count_solutions(next_row, next_col, limit);
-            board[row][col].player_num = 0;
-            
-            if (solutions > limit) {
-                return solutions;
-            }
+    }
+}
+
+static int dlx_count_solutions(const unsigned char givens[MAX_CELLS], int limit) {
+    dlx_load_board(givens);
+    return dlx_search(&sudoku_dlx, limit, NULL, NULL);
+}
+
+static bool dlx_solve(const unsigned char givens[MAX_CELLS], unsigned char solution[MAX_CELLS]) {
+    int rows[MAX_CELLS];
+    int length = 0;
+
+    dlx_load_board(givens);
+    if (dlx_search(&sudoku_dlx, 1, rows, &length) == 0) return false;
+
+    for (int i = 0; i < length; i++) {
+        solution[rows[i] / board_size] = rows[i] % board_size + 1;
+    }
+    return true;
+}
+
+static void count_digit(int row, int col, int num, int delta) {
+    int box = box_of(row, col);
+    int *counts[3] = {&row_counts[row][num], &col_counts[col][num], &box_counts[box][num]};
+    uint32_t *present[3] = {&row_present[row], &col_present[col], &box_present[box]};
+    uint32_t bit = 1 << (num - 1);
+
+    for (int i = 0; i < 3; i++) {
+        int before = *counts[i];
+        *counts[i] += delta;
+        if (*counts[i] == 2 && before == 1) conflict_units++;
+        if (*counts[i] == 1 && before == 2) conflict_units--;
+        if (*counts[i] == 0) *present[i] &= ~bit;
+        if (*counts[i] == 1) *present[i] |= bit;
+    }
+    filled_cells += delta;
+}
+
+static void set_cell(int row, int col, int num) {
+    int old = board[row][col].player_num;
+    if (old == num) return;
+    if (old != 0) count_digit(row, col, old, -1);
+    board[row][col].player_num = num;
+    if (num != 0) count_digit(row, col, num, 1);
+}
+
+static void reset_counts() {
+    memset(row_counts, 0, sizeof(row_counts));
+    memset(col_counts, 0, sizeof(col_counts));
+    memset(box_counts, 0, sizeof(box_counts));
+    memset(row_present, 0, sizeof(row_present));
+    memset(col_present, 0, sizeof(col_present));
+    memset(box_present, 0, sizeof(box_present));
+    filled_cells = 0;
+    conflict_units = 0;
+
+    for (int y = 0; y < board_size; y++) {
+        for (int x = 0; x < board_size; x++) {
+            if (board[y][x].player_num != 0) count_digit(y, x, board[y][x].player_num, 1);
         }
     }
-    
-    return solutions;
+}
+
+static bool is_conflict(int row, int col) {
+    int num = board[row][col].player_num;
+    if (num == 0) return false;
+    return row_counts[row][num] > 1 || col_counts[col][num] > 1 || box_counts[box_of(row, col)][num] > 1;
+}
+
+static uint32_t cell_candidates(int row, int col) {
+    return all_digits & ~(row_present[row] | col_present[col] | box_present[box_of(row, col)]);
 }
 
 static bool win_check() {
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            if (board[y][x].player_num != board[y][x].real_num) {
-                return false;
-            }
+    return filled_cells == cell_count && conflict_units == 0;
+}
+
+static void shuffle_lines(int *order, uint32_t *seed) {
+    int bands[MAX_BOARD_SIZE];
+    for (int i = 0; i < box_size; i++) bands[i] = i;
+    shuffle(bands, box_size, seed);
+
+    for (int band = 0; band < box_size; band++) {
+        int lines[MAX_BOARD_SIZE];
+        for (int i = 0; i < box_size; i++) lines[i] = bands[band] * box_size + i;
+        shuffle(lines, box_size, seed);
+        memcpy(&order[band * box_size], lines, box_size * sizeof(int));
+    }
+}
+
+static void fill_solution(unsigned char solution[MAX_CELLS], uint32_t *seed) {
+    SolverGrid grid;
+    unsigned char empty[MAX_CELLS] = {0};
+    int budget = SEARCH_BUDGET;
+
+    solver_load(&grid, empty);
+    if (solver_search(&grid, 1, solution, seed, &budget) == 1 && budget >= 0) return;
+
+    int digits[MAX_BOARD_SIZE], rows[MAX_BOARD_SIZE], cols[MAX_BOARD_SIZE];
+    for (int i = 0; i < board_size; i++) digits[i] = i + 1;
+    shuffle(digits, board_size, seed);
+    shuffle_lines(rows, seed);
+    shuffle_lines(cols, seed);
+
+    for (int y = 0; y < board_size; y++) {
+        for (int x = 0; x < board_size; x++) {
+            int r = rows[y], c = cols[x];
+            solution[y * board_size + x] = digits[((r % box_size) * box_size + r / box_size + c) % board_size];
         }
     }
-    return true;
 }
 
-static bool fill_board(int row, int col) {
-    if (row == BOARD_HEIGHT) return true; 
+static void dig_puzzle(Puzzle *puzzle, Difficulty target, uint32_t *seed) {
+    fill_solution(puzzle->solution, seed);
+    memcpy(puzzle->givens, puzzle->solution, cell_count);
+    int search_budget = SEARCH_BUDGET * 9 * 9 / cell_count;
 
-    int next_row = (col == BOARD_WIDTH -1) ? row + 1: row;
-    int next_col = (col == BOARD_WIDTH -1) ? 0 : col + 1;
+    int order[MAX_CELLS];
+    for (int i = 0; i < cell_count; i++) order[i] = i;
+    shuffle(order, cell_count, seed);
 
-    int nums[9] = {1,2,3,4,5,6,7,8,9};
+    for (int i = 0; i < cell_count; i++) {
+        int cell = order[i];
+        unsigned char temp = puzzle->givens[cell];
+        puzzle->givens[cell] = 0;
 
-    for (int i = 8; i > 0; i--) {
-        int j = rand() % (i+ 1);
-        int temp = nums[i];
-        nums[i] = nums[j];
-        nums[j] = temp;
+        // A puzzle that singles alone can solve is already unique, so the
+        // bounded search only runs for ones that need guessing.
+        Difficulty grade = grade_puzzle(puzzle->givens);
+        if (grade > target || (grade == DIFFICULTY_HARD && count_solutions_bounded(puzzle->givens, 2, search_budget) != 1)) {
+            puzzle->givens[cell] = temp;
+        }
     }
+    puzzle->difficulty = grade_puzzle(puzzle->givens);
+}
 
-    for (int i = 0; i < 9; i++) {
-        int num = nums[i];
-        if (is_valid_pos(num,row,col)) {
-            board[row][col].real_num = num;
+// Relabels digits, permutes bands, stacks and the lines inside them, and
+// optionally transposes. Every one of these keeps the puzzle valid, unique and
+// solvable by the same techniques, so the difficulty carries over unchanged.
+static void transform_puzzle(const Puzzle *source, Puzzle *puzzle, uint32_t *seed) {
+    int digits[MAX_BOARD_SIZE + 1], rows[MAX_BOARD_SIZE], cols[MAX_BOARD_SIZE];
+    digits[0] = 0;
+    for (int i = 1; i <= board_size; i++) digits[i] = i;
+    shuffle(digits + 1, board_size, seed);
+    shuffle_lines(rows, seed);
+    shuffle_lines(cols, seed);
+    bool transpose = next_random(seed) & 1;
 
-            if (fill_board(next_row, next_col)) {
-                return true;
-            }
-            board[row][col].real_num = 0;
+    for (int y = 0; y < board_size; y++) {
+        for (int x = 0; x < board_size; x++) {
+            int from = transpose ? cols[x] * board_size + rows[y] : rows[y] * board_size + cols[x];
+            puzzle->givens[y * board_size + x] = digits[source->givens[from]];
+            puzzle->solution[y * board_size + x] = digits[source->solution[from]];
         }
     }
-    return false;
+    puzzle->difficulty = source->difficulty;
 }
 
-static void gen_board() {
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            board[y][x].pos.x = x;
-            board[y][x].pos.y = y;
-            board[y][x].real_num = 0;
-            board[y][x].player_num = 0;
-            board[y][x].preloaded = true;
+static void init_seed_bank() {
+    seed_bank_count = 0;
+    for (size_t i = 0; i < sizeof(seed_puzzles) / sizeof(seed_puzzles[0]); i++) {
+        Puzzle *puzzle = &seed_bank[seed_bank_count];
+        SolverGrid grid;
+
+        if (!parse_puzzle(seed_puzzles[i].givens, strlen(seed_puzzles[i].givens), puzzle->givens)) continue;
+        if (!solver_load(&grid, puzzle->givens)) continue;
+        if (solver_search(&grid, 2, puzzle->solution, NULL, NULL) != 1) continue;
+
+        puzzle->difficulty = grade_puzzle(puzzle->givens);
+        if (puzzle->difficulty == seed_puzzles[i].difficulty) seed_bank_count++;
+    }
+}
+
+static void gen_puzzle(Puzzle *puzzle, Difficulty target, uint32_t *seed) {
+    int matches = 0;
+    for (int i = 0; i < seed_bank_count; i++) {
+        if (seed_bank[i].difficulty == target) matches++;
+    }
+    if (matches == 0) {
+        dig_puzzle(puzzle, target, seed);
+        return;
+    }
+
+    int pick = next_random(seed) % matches;
+    for (int i = 0; i < seed_bank_count; i++) {
+        if (seed_bank[i].difficulty == target && pick-- == 0) {
+            transform_puzzle(&seed_bank[i], puzzle, seed);
+            return;
+        }
+    }
+}
+
+static void init_line_orders() {
+    for (int perm = 0; perm < LINE_ORDERS; perm++) {
+        int outer = perm % 6;
+        for (int group = 0; group < 3; group++) {
+            int inner = (perm / (group == 0 ? 6 : group == 1 ? 36 : 216)) % 6;
+            for (int i = 0; i < 3; i++) {
+                line_orders[perm][group * 3 + i] = perms3[outer][group] * 3 + perms3[inner][i];
+            }
         }
     }
+}
+
+// Smallest form over all 2 * 6^8 row/column symmetries of a 9x9 grid, with
+// digits relabeled in order of first appearance. The first output row only
+// depends on which source row lands there and on the column order, so those
+// 2 * 9 * 1296 choices are ranked first and the full row orders are only
+// tried for the ones that tie for the smallest first row.
+static void canonical_form(const unsigned char givens[MAX_CELLS], unsigned char best[MAX_CELLS]) {
+    unsigned char sources[2][MAX_CELLS];
+    unsigned char out[MAX_CELLS];
+    unsigned char best_row[9];
 
-    fill_board(0,0);
+    for (int i = 0; i < cell_count; i++) {
+        sources[0][i] = givens[i];
+        sources[1][i] = givens[(i % 9) * 9 + i / 9];
+    }
 
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            board[y][x].player_num = board[y][x].real_num;
+    memset(best_row, 0xff, sizeof(best_row));
+    for (int transpose = 0; transpose < 2; transpose++) {
+        for (int first = 0; first < 9; first++) {
+            for (int col_perm = 0; col_perm < LINE_ORDERS; col_perm++) {
+                const unsigned char *row = &sources[transpose][first * 9];
+                unsigned char labels[10] = {0};
+                int next_label = 1;
+                int cmp = 0;
+                for (int i = 0; i < 9 && cmp <= 0; i++) {
+                    int value = row[line_orders[col_perm][i]];
+                    if (value != 0) {
+                        if (labels[value] == 0) labels[value] = next_label++;
+                        value = labels[value];
+                    }
+                    if (cmp == 0 && value != best_row[i]) cmp = (value < best_row[i]) ? -1 : 1;
+                    out[i] = value;
+                }
+                if (cmp < 0) memcpy(best_row, out, sizeof(best_row));
+            }
         }
     }
 
-    int cells_to_remove = 40;
+    memset(best, 0xff, cell_count);
+    for (int transpose = 0; transpose < 2; transpose++) {
+        const unsigned char *source = sources[transpose];
+        for (int first = 0; first < 9; first++) {
+            for (int col_perm = 0; col_perm < LINE_ORDERS; col_perm++) {
+                const int *cols = line_orders[col_perm];
+                unsigned char labels[10] = {0};
+                int next_label = 1;
+                bool ties = true;
+                for (int i = 0; i < 9 && ties; i++) {
+                    int value = source[first * 9 + cols[i]];
+                    if (value != 0) {
+                        if (labels[value] == 0) labels[value] = next_label++;
+                        value = labels[value];
+                    }
+                    ties = (value == best_row[i]);
+                }
+                if (!ties) continue;
 
-    for (int i = 0; i < cells_to_remove; i ++){ 
-        int attempts = 0;
-        bool found = false;
+                for (int row_perm = 0; row_perm < LINE_ORDERS; row_perm++) {
+                    const int *rows = line_orders[row_perm];
+                    if (rows[0] != first) continue;
 
-        while (attempts < 100 && !found) {
-            int y = rand() % BOARD_HEIGHT;
-            int x = rand() % BOARD_WIDTH;
+                    unsigned char row_labels[10];
+                    memcpy(row_labels, labels, sizeof(row_labels));
+                    int row_next = next_label;
+                    bool better = false;
+                    bool worse = false;
 
-            if (board[y][x].player_num == 0) {
-                attempts++;
-                continue;
+                    for (int i = 9; i < cell_count && !worse; i++) {
+                        int value = source[rows[i / 9] * 9 + cols[i % 9]];
+                        if (value != 0) {
+                            if (row_labels[value] == 0) row_labels[value] = row_next++;
+                            value = row_labels[value];
+                        }
+                        if (!better) {
+                            if (value > best[i]) worse = true;
+                            else if (value < best[i]) better = true;
+                        }
+                        out[i] = value;
+                    }
+                    if (better) {
+                        memcpy(out, best_row, sizeof(best_row));
+                        memcpy(best, out, cell_count);
+                    }
+                }
             }
+        }
+    }
+}
 
-            int temp = board[y][x].player_num;
-            board[y][x].player_num = 0;
+static uint64_t canonical_hash(const unsigned char canonical[MAX_CELLS]) {
+    uint64_t hash = FNV_OFFSET;
+    for (int i = 0; i < cell_count; i++) {
+        hash ^= canonical[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
 
-            if (count_solutions(0,0,2) == 1) {
-                board[y][x].preloaded = false;
-                found = true;
-            } else {
-                board[y][x].player_num = temp;
+static bool pool_push(PuzzleQueue *queue, const Puzzle *puzzle) {
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&queue->head, memory_order_acquire) == POOL_SIZE) {
+        return false;
+    }
+    queue->slots[tail % POOL_SIZE] = *puzzle;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static bool pool_pop(PuzzleQueue *queue, Puzzle *puzzle) {
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&queue->tail, memory_order_acquire)) {
+        return false;
+    }
+    *puzzle = queue->slots[head % POOL_SIZE];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+static bool pool_full(PuzzleQueue *queue) {
+    return atomic_load(&queue->tail) - atomic_load(&queue->head) == POOL_SIZE;
+}
+
+static void *generator_main(void *arg) {
+    uint32_t seed = (uint32_t)(uintptr_t)arg | 1;
+    int misses[DIFFICULTY_COUNT] = {0};
+    Puzzle puzzle;
+
+    while (atomic_load(&generator_running)) {
+        Difficulty wanted = atomic_load(&target_difficulty);
+        if (pool_full(&puzzle_pool[wanted]) || misses[wanted] >= MAX_GEN_ATTEMPTS) {
+            wanted = DIFFICULTY_COUNT;
+            for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+                if (!pool_full(&puzzle_pool[d]) && misses[d] < MAX_GEN_ATTEMPTS) {
+                    wanted = d;
+                    break;
+                }
             }
-            attempts++;
         }
-        if (!found) {
+        if (wanted == DIFFICULTY_COUNT) {
+            usleep(10000);
+            continue;
+        }
+
+        // Small boards never need guessing, so stop chasing a difficulty
+        // after repeated misses instead of spinning on it forever.
+        gen_puzzle(&puzzle, wanted, &seed);
+        misses[wanted] = (puzzle.difficulty == wanted) ? 0 : misses[wanted] + 1;
+        pool_push(&puzzle_pool[puzzle.difficulty], &puzzle);
+    }
+    return NULL;
+}
+
+static void start_generator() {
+    atomic_store(&generator_running, true);
+    if (pthread_create(&generator_thread, NULL, generator_main, (void *)(uintptr_t)time(NULL)) != 0) {
+        atomic_store(&generator_running, false);
+    }
+}
+
+static void stop_generator() {
+    if (!atomic_load(&generator_running)) return;
+    atomic_store(&generator_running, false);
+    pthread_join(generator_thread, NULL);
+}
+
+static int bank_record_size(int size) {
+    int cells = size * size;
+    return (cells + 1) / 2 + (cells + 7) / 8;
+}
+
+static void pack_puzzle(const Puzzle *puzzle, unsigned char *record) {
+    unsigned char *givens = record + (cell_count + 1) / 2;
+    memset(record, 0, bank_record_size(board_size));
+    for (int cell = 0; cell < cell_count; cell++) {
+        record[cell / 2] |= (puzzle->solution[cell] - 1) << ((cell & 1) * 4);
+        if (puzzle->givens[cell]) givens[cell / 8] |= 1 << (cell & 7);
+    }
+}
+
+static void unpack_puzzle(const unsigned char *record, Difficulty difficulty, Puzzle *puzzle) {
+    const unsigned char *givens = record + (cell_count + 1) / 2;
+    for (int cell = 0; cell < cell_count; cell++) {
+        puzzle->solution[cell] = ((record[cell / 2] >> ((cell & 1) * 4)) & 0xf) + 1;
+        puzzle->givens[cell] = (givens[cell / 8] >> (cell & 7) & 1) ? puzzle->solution[cell] : 0;
+    }
+    puzzle->difficulty = difficulty;
+}
+
+static uint64_t bank_checksum(uint64_t hash, const unsigned char *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static bool bank_pick(Difficulty difficulty, Puzzle *puzzle, uint32_t *seed) {
+    if (!bank_data) return false;
+    const BankHeader *header = (const BankHeader *)bank_data;
+    if (header->counts[difficulty] == 0) return false;
+
+    uint32_t index = next_random(seed) % header->counts[difficulty];
+    unpack_puzzle(bank_data + header->offsets[difficulty] + (uint64_t)index * header->record_size, difficulty, puzzle);
+    return true;
+}
+
+static int build_bank(const char *out_path, char **inputs, int input_count) {
+    if (board_size > BANK_MAX_SIZE) {
+        fprintf(stderr, "Banks hold boards up to %dx%d\n", BANK_MAX_SIZE, BANK_MAX_SIZE);
+        return 1;
+    }
+
+    int record_size = bank_record_size(board_size);
+    unsigned char *records[DIFFICULTY_COUNT] = {NULL};
+    size_t capacity[DIFFICULTY_COUNT] = {0};
+    BankHeader header;
+    long skipped = 0;
+    char line[MAX_CELLS + 8];
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BANK_MAGIC, sizeof(header.magic));
+    header.board_size = board_size;
+    header.record_size = record_size;
+
+    // Any input that cannot be read or held fails the whole build, so a bank
+    // is never written with puzzles silently missing.
+    bool ok = true;
+    for (int f = 0; ok && f < input_count; f++) {
+        FILE *in = fopen(inputs[f], "r");
+        if (!in) {
+            fprintf(stderr, "Could not open %s\n", inputs[f]);
+            ok = false;
             break;
         }
+        while (ok && fgets(line, sizeof(line), in)) {
+            int length = strcspn(line, "\r\n");
+            if (length == 0) continue;
+
+            Puzzle puzzle;
+            SolverGrid grid;
+            if (!parse_puzzle(line, length, puzzle.givens) || !solver_load(&grid, puzzle.givens) ||
+                solver_search(&grid, 2, puzzle.solution, NULL, NULL) != 1) {
+                skipped++;
+                continue;
+            }
+            puzzle.difficulty = grade_puzzle(puzzle.givens);
+
+            Difficulty d = puzzle.difficulty;
+            if ((header.counts[d] + 1) * (size_t)record_size > capacity[d]) {
+                size_t grown = capacity[d] * 2 + 64 * record_size;
+                unsigned char *resized = realloc(records[d], grown);
+                if (!resized) {
+                    fprintf(stderr, "Out of memory\n");
+                    ok = false;
+                    break;
+                }
+                records[d] = resized;
+                capacity[d] = grown;
+            }
+            pack_puzzle(&puzzle, records[d] + header.counts[d] * (size_t)record_size);
+            header.counts[d]++;
+        }
+        fclose(in);
+    }
+    if (!ok) {
+        for (int d = 0; d < DIFFICULTY_COUNT; d++) free(records[d]);
+        return 1;
+    }
+
+    uint64_t offset = sizeof(BankHeader);
+    header.checksum = FNV_OFFSET;
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        header.offsets[d] = offset;
+        offset += header.counts[d] * (uint64_t)record_size;
+        header.checksum = bank_checksum(header.checksum, records[d], header.counts[d] * (size_t)record_size);
+    }
+
+    FILE *out = fopen(out_path, "wb");
+    if (!out) {
+        fprintf(stderr, "Could not write %s\n", out_path);
+        for (int d = 0; d < DIFFICULTY_COUNT; d++) free(records[d]);
+        return 1;
+    }
+    fwrite(&header, sizeof(header), 1, out);
+    for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+        fwrite(records[d], record_size, header.counts[d], out);
+        free(records[d]);
+    }
+    fclose(out);
+
+    fprintf(stderr, "Wrote %s: %u easy, %u medium, %u hard, %ld skipped (%d bytes each)\n",
+        out_path, header.counts[0], header.counts[1], header.counts[2], skipped, record_size);
+    return 0;
+}
+
+#ifndef _WIN32
+// Only the header is checked so opening stays O(1); verify_checksum walks the
+// records and is used by --verify-bank.
+static bool open_bank(const char *path, bool verify_checksum) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(BankHeader)) {
+        if (fd >= 0) close(fd);
+        return false;
+    }
+
+    const unsigned char *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    const BankHeader *header = (const BankHeader *)data;
+    bool valid = memcmp(header->magic, BANK_MAGIC, sizeof(header->magic)) == 0 &&
+        header->board_size <= BANK_MAX_SIZE && set_board_size(header->board_size) &&
+        header->record_size == (uint32_t)bank_record_size(header->board_size);
+
+    uint64_t end = sizeof(BankHeader);
+    for (int d = 0; valid && d < DIFFICULTY_COUNT; d++) {
+        valid = header->offsets[d] == end;
+        end += header->counts[d] * (uint64_t)header->record_size;
+    }
+    valid = valid && end == (uint64_t)info.st_size;
+    if (valid && verify_checksum) {
+        valid = bank_checksum(FNV_OFFSET, data + sizeof(BankHeader), end - sizeof(BankHeader)) == header->checksum;
+    }
+
+    if (!valid) {
+        munmap((void *)data, info.st_size);
+        return false;
+    }
+    bank_data = data;
+    bank_size = info.st_size;
+    return true;
+}
+#else
+static bool open_bank(const char *path, bool verify_checksum) {
+    (void)path;
+    (void)verify_checksum;
+    return false;
+}
+#endif
+
+static void close_bank() {
+#ifndef _WIN32
+    if (bank_data) munmap((void *)bank_data, bank_size);
+#endif
+    bank_data = NULL;
+    bank_size = 0;
+}
+
+static void gen_board() {
+    Difficulty wanted = atomic_load(&target_difficulty);
+    Puzzle puzzle;
+
+    if (!bank_pick(wanted, &puzzle, &ui_seed) && !pool_pop(&puzzle_pool[wanted], &puzzle)) {
+        int attempts = 0;
+        do {
+            gen_puzzle(&puzzle, wanted, &ui_seed);
+        } while (puzzle.difficulty != wanted && ++attempts < MAX_GEN_ATTEMPTS);
     }
+
+    for (int y = 0; y < board_size; y++) {
+        for (int x = 0; x < board_size; x++) {
+            int cell = y * board_size + x;
+            board[y][x].pos.x = x;
+            board[y][x].pos.y = y;
+            board[y][x].real_num = puzzle.solution[cell];
+            board[y][x].player_num = puzzle.givens[cell];
+            board[y][x].preloaded = puzzle.givens[cell] != 0;
+        }
+    }
+    board_difficulty = puzzle.difficulty;
+    reset_counts();
 }
 
 static void render() {
-    printf("╔");
-    for (int x = 0; x < BOARD_WIDTH; x++) {
-        printf("═══");
-        if (x < BOARD_WIDTH - 1) {
-            printf("%s", (x % 3 == 2) ? "╦" : "╤");
+    out_printf(&out, "╔");
+    for (int x = 0; x < board_size; x++) {
+        out_printf(&out, "═══");
+        if (x < board_size - 1) {
+            out_printf(&out, "%s", (x % box_size == box_size - 1) ? "╦" : "╤");
         }
     }
-    printf("╗\n");
+    out_printf(&out, "╗\n");
 
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        printf("║");
-        for (int x = 0; x < BOARD_WIDTH; x++) {
+    int cursor_num = board[player_pos.y][player_pos.x].player_num;
+    for (int y = 0; y < board_size; y++) {
+        out_printf(&out, "║");
+        for (int x = 0; x < board_size; x++) {
             bool is_cursor = (x == player_pos.x && y == player_pos.y);
-            bool is_same_num = (board[y][x].player_num == board[player_pos.y][player_pos.x].player_num && board[y][x].player_num > 0);
+            bool is_same_num = (cursor_num > 0 && board[y][x].player_num == cursor_num);
+            bool conflict = is_conflict(y, x);
 
             if (is_cursor) {
-                printf("\033[7m");
+                out_printf(&out, conflict ? "\033[7;31m" : "\033[7m");
+            } else if (conflict) {
+                out_printf(&out, "\033[41m");
             } else if (is_same_num) {
-                printf("\033[48;5;208m");
+                out_printf(&out, "\033[48;5;208m");
             }
             
             if (board[y][x].player_num == 0) {
-                printf("   ");
+                out_printf(&out, "   ");
             } else {
-                printf(" %d ", board[y][x].player_num);
+                out_printf(&out, " %c ", num_symbol(board[y][x].player_num));
             }
 
-            if (is_cursor || is_same_num) printf("\033[0m");
+            if (is_cursor || conflict || is_same_num) out_printf(&out, "\033[0m");
 
-            if (x % 3 == 2) {
-                printf("║");
+            if (x % box_size == box_size - 1) {
+                out_printf(&out, "║");
             } else {
-                printf("│");
+                out_printf(&out, "│");
             }
         }
-        printf("\n");
+        out_printf(&out, "\n");
 
-        if (y < BOARD_HEIGHT - 1) {
-            printf("%s", (y % 3 == 2) ? "╠" : "╟");
+        if (y < board_size - 1) {
+            out_printf(&out, "%s", (y % box_size == box_size - 1) ? "╠" : "╟");
 
-            for (int x = 0; x < BOARD_WIDTH; x++) {
-                if (y % 3 == 2) { 
-                    printf("═══");
+            for (int x = 0; x < board_size; x++) {
+                if (y % box_size == box_size - 1) { 
+                    out_printf(&out, "═══");
                 } else {
-                    printf("───");
+                    out_printf(&out, "───");
                 }
-                if (x < BOARD_WIDTH - 1) {
-                    if (x % 3 == 2 && y % 3 == 2) {
-                        printf("╬");
-                    } else if(x % 3 == 2) {
-                        printf("╫");
-                    } else if (y % 3 == 2) {
-                        printf("╪");
+                if (x < board_size - 1) {
+                    if (x % box_size == box_size - 1 && y % box_size == box_size - 1) {
+                        out_printf(&out, "╬");
+                    } else if(x % box_size == box_size - 1) {
+                        out_printf(&out, "╫");
+                    } else if (y % box_size == box_size - 1) {
+                        out_printf(&out, "╪");
                     } else {
-                        printf("┼");
+                        out_printf(&out, "┼");
                     }
                 }
             }
-            printf("%s\n", (y % 3 == 2) ? "╣" : "╢");
+            out_printf(&out, "%s\n", (y % box_size == box_size - 1) ? "╣" : "╢");
         }
     }
 
-    printf("╚");
-    for (int x = 0; x < BOARD_WIDTH; x++) {
-        printf("═══");
-        if (x < BOARD_WIDTH - 1) {
-            printf("%s", (x % 3 == 2) ? "╩" : "╧");
+    out_printf(&out, "╚");
+    for (int x = 0; x < board_size; x++) {
+        out_printf(&out, "═══");
+        if (x < board_size - 1) {
+            out_printf(&out, "%s", (x % box_size == box_size - 1) ? "╩" : "╧");
         }
     }
-    printf("╝\n");
+    out_printf(&out, "╝\n");
 
-    printf("Controls: \nWASD/Arrow Keys to move\nAny number to place a number\nDelete to reset a square\nR to restart\n");
+    if (show_candidates) {
+        out_printf(&out, "Candidates:");
+        if (cursor_num == 0) {
+            uint32_t candidates = cell_candidates(player_pos.y, player_pos.x);
+            for (int num = 1; num <= board_size; num++) {
+                if (candidates & (1u << (num - 1))) out_printf(&out, " %c", num_symbol(num));
+            }
+        }
+        out_printf(&out, "\n");
+    }
+    out_printf(&out, "Difficulty: %s | Next game: %s\n", difficulty_names[board_difficulty], difficulty_names[atomic_load(&target_difficulty)]);
+    out_printf(&out, "Controls: \nWASD/Arrow Keys to move\nAny number to place a number\nDelete to reset a square\nR to restart\nE to change difficulty\nP to toggle candidates\nT to show frame stats\n");
+    if (board_size > 9) {
+        out_printf(&out, "Uppercase A-%c for values above 9\n", num_symbol(board_size));
+    }
+    if (stats_visible) {
+        char line[128];
+        for (int i = 0; i < STATS_OVERLAY_LINES; i++) {
+            stats_overlay_line(&stats, i, line, sizeof(line));
+            out_printf(&out, "%s\n", line);
+        }
+    }
+}
 
-    fflush(stdout);
+// Sends the board as one frame and records it with the timings of the tick
+// that drew it; the caller checks the terminal is ready.
+static void draw_frame(long input_ns, long update_ns) {
+    long long build_start = stats_now_ns();
+    out_printf(&out, CLEAR_SCREEN);
+    render();
+    long long build_done = stats_now_ns();
+    out_submit(&out);
+    stats_record_frame(&stats, input_ns, update_ns, build_start, build_done, out.bytes_written, out.syscalls);
+    board_changed = false;
 }
 
 static void reset_game() {
-    player_pos = (Position){BOARD_WIDTH / 2, BOARD_HEIGHT /2};
+    player_pos = (Position){board_size / 2, board_size /2};
     last_player_pos = (Position){-1,-1};
     board_changed = true;
     gen_board();
-    system(CLEAR_CMD); 
-    render();
-    board_changed = false;
 }
 
 static void process_input() {
@@ -387,29 +1226,47 @@ static void process_input() {
         return;
     }
 
+    int num = symbol_num(key);
+    if (num > 0 && num <= board_size && (key <= '9' || board_size > 9)) {
+        if (!board[player_pos.y][player_pos.x].preloaded) {
+            set_cell(player_pos.y, player_pos.x, num);
+            board_changed = true;
+        }
+        return;
+    }
+
     switch(key) {
         case 'w': case 'W': player_pos.y--; break;
         case 's': case 'S': player_pos.y++; break;
         case 'd': case 'D': player_pos.x++; break;
         case 'a': case 'A': player_pos.x--; break;
         case 'q': case 'Q': 
+            stop_generator();
+            close_bank();
+            out_close(&out);
+            stats_close(&stats);
             cleanup_terminal();
             exit(0);
             break;
-        case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
-            if (board[player_pos.y][player_pos.x].preloaded) break;
-            key -= '0';
-            board[player_pos.y][player_pos.x].player_num = key; 
-            board_changed = true; 
-            break;
-        
         case 127:
             if (board[player_pos.y][player_pos.x].preloaded) break;
-            board[player_pos.y][player_pos.x].player_num = 0; board_changed = true; break;
+            set_cell(player_pos.y, player_pos.x, 0); board_changed = true; break;
         
         case 'r': case 'R': 
             reset_game();
             break; 
+        case 'p': case 'P':
+            show_candidates = !show_candidates;
+            board_changed = true;
+            break;
+        case 't': case 'T':
+            stats_visible = !stats_visible;
+            board_changed = true;
+            break;
+        case 'e': case 'E':
+            atomic_store(&target_difficulty, (atomic_load(&target_difficulty) + 1) % DIFFICULTY_COUNT);
+            board_changed = true;
+            break;
         default: break;
     }
 
@@ -422,29 +1279,306 @@ static void process_input() {
 
 
 
-int main() {
+static double elapsed_seconds(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void run_benchmark() {
+    int puzzle_count = sizeof(bench_puzzles) / sizeof(bench_puzzles[0]);
+    double mask_total = 0, dlx_total = 0;
+
+    printf("%-4s %12s %12s\n", "#", "bitmask us", "dlx us");
+    for (int p = 0; p < puzzle_count; p++) {
+        unsigned char givens[MAX_CELLS];
+        unsigned char solution[MAX_CELLS];
+        parse_puzzle(bench_puzzles[p], strlen(bench_puzzles[p]), givens);
+
+        if (count_solutions(givens, 2) != 1 || dlx_count_solutions(givens, 2) != 1 || !dlx_solve(givens, solution)) {
+            printf("%-4d solvers disagree on uniqueness\n", p);
+            continue;
+        }
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < BENCH_REPEATS; i++) count_solutions(givens, 2);
+        double mask_time = elapsed_seconds(start) / BENCH_REPEATS;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < BENCH_REPEATS; i++) dlx_count_solutions(givens, 2);
+        double dlx_time = elapsed_seconds(start) / BENCH_REPEATS;
+
+        printf("%-4d %12.1f %12.1f\n", p, mask_time * 1e6, dlx_time * 1e6);
+        mask_total += mask_time;
+        dlx_total += dlx_time;
+    }
+    printf("%-4s %12.1f %12.1f\n", "avg", mask_total * 1e6 / puzzle_count, dlx_total * 1e6 / puzzle_count);
+}
+
+#ifndef _WIN32
+typedef struct {
+    char *output;
+    size_t length;
+    int puzzles;
+    atomic_bool done;
+} BatchChunk;
+
+typedef struct {
+    const char *data;
+    size_t size;
+    BatchChunk *chunks;
+    int chunk_count;
+    atomic_int next_chunk;
+    BatchMode mode;
+} BatchJob;
+
+static void batch_line(BatchJob *job, const char *line, int length, BatchChunk *chunk, size_t *capacity) {
+    if (length > 0 && line[length - 1] == '\r') length--;
+    if (length == 0) return;
+
+    if (chunk->length + cell_count + 32 > *capacity) {
+        size_t grown = *capacity * 2 + cell_count + 32;
+        char *resized = realloc(chunk->output, grown);
+        if (!resized) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        chunk->output = resized;
+        *capacity = grown;
+    }
+    char *out = chunk->output + chunk->length;
+    unsigned char givens[MAX_CELLS];
+    unsigned char solution[MAX_CELLS];
+    SolverGrid grid;
+    int solutions = 0;
+
+    if (parse_puzzle(line, length, givens) && solver_load(&grid, givens)) {
+        solutions = (job->mode == BATCH_CANON) ? 1 : solver_search(&grid, 2, solution, NULL, NULL);
+    }
+
+    if (solutions == 0) {
+        chunk->length += sprintf(out, "invalid\n");
+    } else if (job->mode == BATCH_CANON) {
+        unsigned char canonical[MAX_CELLS];
+        canonical_form(givens, canonical);
+        for (int cell = 0; cell < cell_count; cell++) out[cell] = canonical[cell] ? num_symbol(canonical[cell]) : '.';
+        chunk->length += cell_count;
+        chunk->length += sprintf(out + cell_count, " %016llx\n", (unsigned long long)canonical_hash(canonical));
+    } else if (job->mode == BATCH_CHECK) {
+        if (solutions == 1) {
+            chunk->length += sprintf(out, "unique %s\n", difficulty_names[grade_puzzle(givens)]);
+        } else {
+            chunk->length += sprintf(out, "multiple\n");
+        }
+    } else {
+        for (int cell = 0; cell < cell_count; cell++) out[cell] = num_symbol(solution[cell]);
+        chunk->length += cell_count;
+        chunk->length += sprintf(out + cell_count, solutions == 1 ? "\n" : " multiple\n");
+    }
+    chunk->puzzles++;
+}
+
+// Chunks are fixed byte ranges claimed with an atomic counter. A chunk owns
+// every line that starts inside its range, so no pre-scan for newlines is needed.
+static void *batch_worker(void *arg) {
+    BatchJob *job = arg;
+    int index;
+
+    while ((index = atomic_fetch_add(&job->next_chunk, 1)) < job->chunk_count) {
+        BatchChunk *chunk = &job->chunks[index];
+        size_t capacity = 0;
+        size_t pos = (size_t)index * BATCH_CHUNK_BYTES;
+        size_t end = pos + BATCH_CHUNK_BYTES;
+        if (end > job->size) end = job->size;
+
+        if (pos > 0 && job->data[pos - 1] != '\n') {
+            const char *newline = memchr(job->data + pos, '\n', job->size - pos);
+            pos = newline ? (size_t)(newline - job->data) + 1 : job->size;
+        }
+        while (pos < end) {
+            const char *newline = memchr(job->data + pos, '\n', job->size - pos);
+            size_t line_end = newline ? (size_t)(newline - job->data) : job->size;
+            batch_line(job, job->data + pos, (int)(line_end - pos), chunk, &capacity);
+            pos = line_end + 1;
+        }
+        atomic_store_explicit(&chunk->done, true, memory_order_release);
+    }
+    return NULL;
+}
+
+static int run_batch(const char *path, BatchMode mode) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        fprintf(stderr, "Could not open %s\n", path);
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    if (info.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    BatchJob job;
+    job.size = info.st_size;
+    job.data = mmap(NULL, job.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (job.data == MAP_FAILED) {
+        fprintf(stderr, "Could not map %s\n", path);
+        return 1;
+    }
+    madvise((void *)job.data, job.size, MADV_SEQUENTIAL);
+
+    job.chunk_count = (int)((job.size + BATCH_CHUNK_BYTES - 1) / BATCH_CHUNK_BYTES);
+    job.chunks = calloc(job.chunk_count, sizeof(BatchChunk));
+    job.mode = mode;
+    atomic_init(&job.next_chunk, 0);
+
+    long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (thread_count < 1) thread_count = 1;
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+    if (!job.chunks || !threads) {
+        fprintf(stderr, "Out of memory\n");
+        free(threads);
+        free(job.chunks);
+        munmap((void *)job.data, job.size);
+        return 1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long started = 0;
+    while (started < thread_count && pthread_create(&threads[started], NULL, batch_worker, &job) == 0) started++;
+    // With no helpers the chunks are solved here before the loop below
+    // writes them out.
+    if (started == 0) batch_worker(&job);
+
+    long total = 0;
+    for (int i = 0; i < job.chunk_count; i++) {
+        while (!atomic_load_explicit(&job.chunks[i].done, memory_order_acquire)) {
+            usleep(100);
+        }
+        fwrite(job.chunks[i].output, 1, job.chunks[i].length, stdout);
+        total += job.chunks[i].puzzles;
+        free(job.chunks[i].output);
+    }
+    fflush(stdout);
+
+    for (long i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double seconds = elapsed_seconds(start);
+    fprintf(stderr, "%ld puzzles in %.3f s on %ld threads (%.0f puzzles/s)\n", total, seconds, started ? started : 1, total / (seconds > 0 ? seconds : 1e-9));
+
+    free(threads);
+    free(job.chunks);
+    munmap((void *)job.data, job.size);
+    return 0;
+}
+#else
+static int run_batch(const char *path, BatchMode mode) {
+    (void)path;
+    (void)mode;
+    fprintf(stderr, "Batch mode needs mmap and is not available on Windows\n");
+    return 1;
+}
+#endif
+
+int main(int argc, char *argv[]) {
     srand(time(NULL));
+    ui_seed = (uint32_t)time(NULL) | 1;
+    init_units();
+    init_line_orders();
+    const char *batch_path = NULL;
+    const char *bank_path = NULL;
+    const char *stats_path = NULL;
+    BatchMode batch_mode = BATCH_SOLVE;
+    bool bench = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            i++;
+            for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+                if (strcasecmp(argv[i], difficulty_names[d]) == 0) {
+                    atomic_store(&target_difficulty, d);
+                }
+            }
+        } else if ((strcmp(argv[i], "--solve") == 0 || strcmp(argv[i], "--check") == 0 || strcmp(argv[i], "--canon") == 0) && i + 1 < argc) {
+            batch_mode = strcmp(argv[i], "--check") == 0 ? BATCH_CHECK : strcmp(argv[i], "--canon") == 0 ? BATCH_CANON : BATCH_SOLVE;
+            batch_path = argv[++i];
+        } else if (strcmp(argv[i], "--build-bank") == 0 && i + 2 < argc) {
+            return build_bank(argv[i + 1], &argv[i + 2], argc - i - 2);
+        } else if (strcmp(argv[i], "--verify-bank") == 0 && i + 1 < argc) {
+            bool ok = open_bank(argv[i + 1], true);
+            printf("%s: %s\n", argv[i + 1], ok ? "ok" : "invalid");
+            close_bank();
+            return ok ? 0 : 1;
+        } else if (strcmp(argv[i], "--bank") == 0 && i + 1 < argc) {
+            bank_path = argv[++i];
+        } else if (strcmp(argv[i], "--stats-file") == 0 && i + 1 < argc) {
+            stats_path = argv[++i];
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (!set_board_size(atoi(argv[++i]))) {
+                printf("Board size must be 4, 9, 16 or 25\n");
+                return 1;
+            }
+        }
+    }
+    if (bench) {
+        set_board_size(9);
+        run_benchmark();
+        return 0;
+    }
+    if (batch_path) {
+        if (batch_mode == BATCH_CANON && board_size != 9) {
+            printf("Canonical forms are only defined for 9x9 puzzles\n");
+            return 1;
+        }
+        return run_batch(batch_path, batch_mode);
+    }
+    if (bank_path && !open_bank(bank_path, false)) {
+        printf("Could not open puzzle bank %s\n", bank_path);
+        return 1;
+    }
+    if (!stats_open(&stats, stats_path)) {
+        printf("Could not open %s for writing\n", stats_path);
+        close_bank();
+        return 1;
+    }
+    init_seed_bank();
+    player_pos = (Position){board_size / 2, board_size / 2};
     setup_terminal();
+    out_init(&out, STDOUT_FILENO);
+    if (!bank_data) start_generator();
     gen_board();
-    system(CLEAR_CMD);
-    render();
-    board_changed = false;
+    draw_frame(0, 0);
 
+    // Changes made while the terminal is still busy with the last frame are
+    // drawn together once it catches up.
     while (true) {
+        long long tick_start = stats_now_ns();
         process_input();
-        if (board_changed) {
-            system(CLEAR_CMD);
-            render();
-            if (win_check()) {
-                printf("Game Over! You Win!");
+        long long input_done = stats_now_ns();
+        bool won = board_changed && win_check();
+        long long update_done = stats_now_ns();
+        if (board_changed && out_ready(&out)) {
+            draw_frame(input_done - tick_start, update_done - input_done);
+            if (won) {
+                out_printf(&out, "Game Over! You Win!");
+                out_submit(&out);
                 break;
             }
-            board_changed = false;
         }
 
         usleep(MICROSECONDS_PER_TICK);
     }
 
+    stop_generator();
+    close_bank();
+    out_close(&out);
+    stats_close(&stats);
     cleanup_terminal();
     return 0;
 }
\ No newline at end of file
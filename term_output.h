@@ -0,0 +1,217 @@
+#ifndef TERM_OUTPUT_H
+#define TERM_OUTPUT_H
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+#endif
+
+// Frame output that never blocks the caller. A frame is built in memory with
+// out_printf and handed over with out_submit; it is then written to the
+// terminal in pieces as the terminal accepts them. out_ready says whether the
+// terminal has caught up enough to take another frame, so a renderer that only
+// draws when it is ready always sends its newest frame instead of queueing a
+// backlog of stale ones. Frames are never cut short once started, so frames
+// that draw only what changed stay correct.
+
+#define OUT_BACKLOG_LIMIT 4096
+#define OUT_RATE_WINDOW_MS 500
+#define OUT_FLUSH_TIMEOUT_MS 2000
+
+typedef struct {
+    bool open;
+    bool drained;
+    int fd;
+    int saved_flags;
+    char *frame;
+    size_t frame_length;
+    size_t frame_capacity;
+    char *pending;
+    size_t pending_length;
+    size_t pending_sent;
+    size_t pending_capacity;
+    long frames_sent;
+    long frames_dropped;
+    long would_block;
+    long bytes_written;
+    long syscalls;
+    double bytes_per_second;
+    long window_bytes;
+    int window_queued;
+    struct timespec window_start;
+} TermOutput;
+
+static double out_elapsed_ms(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1e3 + (now.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+// Bytes written but still waiting in the terminal's output queue, where the
+// platform can tell.
+static int out_queued(TermOutput *o) {
+    int queued = 0;
+#if !defined(_WIN32) && defined(TIOCOUTQ)
+    o->syscalls++;
+    if (ioctl(o->fd, TIOCOUTQ, &queued) != 0) queued = 0;
+#else
+    (void) o;
+#endif
+    return queued;
+}
+
+static void out_init(TermOutput *o, int fd) {
+    memset(o, 0, sizeof(*o));
+    o->open = true;
+    o->fd = fd;
+#ifndef _WIN32
+    o->saved_flags = fcntl(fd, F_GETFL);
+    if (o->saved_flags != -1) fcntl(fd, F_SETFL, o->saved_flags | O_NONBLOCK);
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &o->window_start);
+}
+
+static void out_reserve(char **buffer, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) return;
+    size_t grown = *capacity ? *capacity : 4096;
+    while (grown < needed) grown *= 2;
+    char *resized = realloc(*buffer, grown);
+    if (!resized) {
+        fprintf(stderr, "Out of memory for terminal output\n");
+        exit(1);
+    }
+    *buffer = resized;
+    *capacity = grown;
+}
+
+static inline void out_append(TermOutput *o, const char *text, size_t length) {
+    out_reserve(&o->frame, &o->frame_capacity, o->frame_length + length);
+    memcpy(o->frame + o->frame_length, text, length);
+    o->frame_length += length;
+}
+
+static void out_printf(TermOutput *o, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length <= 0) return;
+
+    out_reserve(&o->frame, &o->frame_capacity, o->frame_length + length + 1);
+    va_start(args, format);
+    vsnprintf(o->frame + o->frame_length, length + 1, format, args);
+    va_end(args);
+    o->frame_length += length;
+}
+
+// Measures how fast the terminal drains: bytes accepted over the window less
+// whatever of them is still sitting in its queue.
+static void out_update_rate(TermOutput *o) {
+    double ms = out_elapsed_ms(o->window_start);
+    if (ms < OUT_RATE_WINDOW_MS) return;
+
+    int queued = out_queued(o);
+    double drained = o->window_bytes + o->window_queued - queued;
+    double rate = drained > 0 ? drained * 1000.0 / ms : 0;
+    o->bytes_per_second = o->bytes_per_second > 0 ? (o->bytes_per_second + rate) / 2 : rate;
+    o->window_bytes = 0;
+    o->window_queued = queued;
+    clock_gettime(CLOCK_MONOTONIC, &o->window_start);
+}
+
+// Writes as much of the frame in flight as the terminal will take right now.
+// Returns true once all of it has gone.
+static bool out_pump(TermOutput *o) {
+    while (o->pending_sent < o->pending_length) {
+#ifndef _WIN32
+        ssize_t written = write(o->fd, o->pending + o->pending_sent, o->pending_length - o->pending_sent);
+        o->syscalls++;
+        if (written > 0) {
+            o->pending_sent += written;
+            o->window_bytes += written;
+            o->bytes_written += written;
+            o->drained = false;
+            continue;
+        }
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            o->would_block++;
+            break;
+        }
+        o->pending_sent = o->pending_length;
+#else
+        fwrite(o->pending + o->pending_sent, 1, o->pending_length - o->pending_sent, stdout);
+        fflush(stdout);
+        o->syscalls++;
+        o->window_bytes += o->pending_length - o->pending_sent;
+        o->bytes_written += o->pending_length - o->pending_sent;
+        o->pending_sent = o->pending_length;
+#endif
+    }
+    out_update_rate(o);
+    return o->pending_sent == o->pending_length;
+}
+
+// True when the previous frame has been written out and the terminal has no
+// more than OUT_BACKLOG_LIMIT bytes of it left to display. The queue only
+// shrinks between writes, so once it is short it is not asked again until
+// more has been written.
+static bool out_ready(TermOutput *o) {
+    if (!out_pump(o)) return false;
+    if (!o->drained) o->drained = out_queued(o) <= OUT_BACKLOG_LIMIT;
+    return o->drained;
+}
+
+// Hands the frame built so far to the terminal. Submitting while the last one
+// is still in flight queues this one behind it rather than dropping either.
+static void out_submit(TermOutput *o) {
+    if (o->pending_sent == o->pending_length) {
+        char *swap = o->pending;
+        size_t capacity = o->pending_capacity;
+        o->pending = o->frame;
+        o->pending_capacity = o->frame_capacity;
+        o->pending_length = o->frame_length;
+        o->pending_sent = 0;
+        o->frame = swap;
+        o->frame_capacity = capacity;
+    } else {
+        out_reserve(&o->pending, &o->pending_capacity, o->pending_length + o->frame_length);
+        memcpy(o->pending + o->pending_length, o->frame, o->frame_length);
+        o->pending_length += o->frame_length;
+    }
+    o->frame_length = 0;
+    o->frames_sent++;
+    out_pump(o);
+}
+
+// Finishes the frame in flight, waiting for the terminal if need be, and puts
+// the descriptor back the way out_init found it. Does nothing if out_init was
+// never called, so exit paths can call it unconditionally.
+static void out_close(TermOutput *o) {
+    if (!o->open) return;
+    o->open = false;
+#ifndef _WIN32
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (!out_pump(o) && out_elapsed_ms(start) < OUT_FLUSH_TIMEOUT_MS) {
+        usleep(1000);
+    }
+    if (o->saved_flags != -1) fcntl(o->fd, F_SETFL, o->saved_flags);
+#else
+    out_pump(o);
+#endif
+    free(o->frame);
+    free(o->pending);
+    o->frame = o->pending = NULL;
+}
+
+#endif
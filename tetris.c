@@ -4,14 +4,18 @@
 #include <unistd.h>
 #include <time.h>
 #include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "triple_buffer.h"
+#include "term_output.h"
+#include "frame_stats.h"
+#include "game_loop.h"
 #ifdef _WIN32
     #include <conio.h>
     #include <windows.h>
-    #define CLEAR_CMD "cls"
 #else
     #include <termios.h>
     #include <fcntl.h>
-    #define CLEAR_CMD "clear"
 #endif
 
 #define TICK_RATE 120
@@ -20,6 +24,7 @@
 #define BOARD_HEIGHT 20
 #define BLOCK_TYPES 4
 #define MAX_SCORES 5
+#define CLEAR_SCREEN "\033[H\033[2J"
 
 typedef struct {
     int x, y;
@@ -37,6 +42,22 @@ typedef struct {
     char name[16];
 } Highscore; 
 
+// Everything render needs, copied out by the simulation whenever it changes.
+typedef struct {
+    FrameInfo info;
+    int board[BOARD_HEIGHT][BOARD_WIDTH];
+    int color[BOARD_HEIGHT][BOARD_WIDTH];
+    Piece piece;
+    Piece next_piece;
+    int score;
+    int level;
+    int rows_cleared;
+    int block_appearance;
+    int col_element;
+    bool paused;
+    bool stats_visible;
+} Snapshot;
+
 int board[BOARD_HEIGHT][BOARD_WIDTH] = {0};
 int color[BOARD_HEIGHT][BOARD_WIDTH] = {0};
 int fall_counter = 0;
@@ -49,8 +70,21 @@ bool paused = false;
 int block_appearance = 0;
 int col_element = 31;
 bool title_flash_pause = false;
+bool stats_visible = false;
 Highscore highscores[MAX_SCORES];
 
+// The simulation runs on its own thread at TICK_RATE and publishes a Snapshot
+// after each tick; the render thread draws the newest one it finds, so a slow
+// terminal costs frames rather than slowing gravity down. A quit key only
+// sets quit_requested; running is cleared after the tick's snapshot is
+// published, so the last frame always reaches the screen.
+static Snapshot snapshot_slots[3];
+static TripleBuffer snapshots;
+static atomic_bool running;
+static TermOutput out;
+static FrameStats stats;
+static bool quit_requested = false;
+
 const int base_I_piece[4][4] = {
     {0, 0, 0, 0},
     {1, 1, 1, 1},
@@ -298,45 +332,50 @@ static bool is_game_over() {
     return false;
 }
 
-static void print_color_block(int color_val) {
+static void print_color_block(int appearance, int color_val) {
     char* block = "[]";
-    switch (block_appearance) {
+    switch (appearance) {
         case 0: block = "██"; break;
         case 1: block = "[]"; break;
         case 2: block = "░░"; break;
         case 3: block = "##"; break;
     }
     switch(color_val) {
-        case 1: printf("\033[32m%s\033[0m", block); break; // Green
-        case 2: printf("\033[31m%s\033[0m", block); break; // Red
-        case 3: printf("\033[34m%s\033[0m", block); break; // Blue
-        case 4: printf("\033[93m%s\033[0m", block); break; // Yellow
-        case 5: printf("\033[96m%s\033[0m", block); break; // Cyan
-        case 6: printf("\033[95m%s\033[0m", block); break; // Magenta
-        default: printf("  "); break;
+        case 1: out_printf(&out, "\033[32m%s\033[0m", block); break; // Green
+        case 2: out_printf(&out, "\033[31m%s\033[0m", block); break; // Red
+        case 3: out_printf(&out, "\033[34m%s\033[0m", block); break; // Blue
+        case 4: out_printf(&out, "\033[93m%s\033[0m", block); break; // Yellow
+        case 5: out_printf(&out, "\033[96m%s\033[0m", block); break; // Cyan
+        case 6: out_printf(&out, "\033[95m%s\033[0m", block); break; // Magenta
+        default: out_append(&out, "  ", 2); break;
     }
 }
 
-static void print_title() {
+static void update_title_color() {
     if (fall_counter % 20 == 0 && !title_flash_pause) {
         int col_list[] = {32, 31, 34, 93, 96, 95};
         int list_size = sizeof(col_list) / sizeof(col_list[0]);
         col_element = col_list[rand() % list_size];
     } 
-    printf("\033[%dm _____    _        _     \n", col_element);
-    printf("|_   _|__| |_ _ __(_)___ \n");
-    printf("  | |/ _ \\ __| '__| / __|\n");
-    printf("  | |  __/ |_| |  | \\__ \\\n");
-    printf("  |_|\\___|\\__|_|  |_|___/\n");
-    printf("                         \n\033[0m");
 }
 
-static void render(Piece* piece, Piece* next_piece) {
+static void print_title(int title_color) {
+    out_printf(&out, "\033[%dm _____    _        _     \n", title_color);
+    out_printf(&out, "|_   _|__| |_ _ __(_)___ \n");
+    out_printf(&out, "  | |/ _ \\ __| '__| / __|\n");
+    out_printf(&out, "  | |  __/ |_| |  | \\__ \\\n");
+    out_printf(&out, "  |_|\\___|\\__|_|  |_|___/\n");
+    out_printf(&out, "                         \n\033[0m");
+}
+
+static void render(const Snapshot* snap) {
     char disp_board[BOARD_HEIGHT][BOARD_WIDTH];
+    const Piece* piece = &snap->piece;
+    const Piece* next_piece = &snap->next_piece;
 
     for (int y = 0; y < BOARD_HEIGHT; y++) {
         for (int x = 0; x < BOARD_WIDTH; x++) {
-            disp_board[y][x] = board[y][x] ? '#' : ' ';
+            disp_board[y][x] = snap->board[y][x] ? '#' : ' ';
         }
     }
 
@@ -353,60 +392,68 @@ static void render(Piece* piece, Piece* next_piece) {
             }
         }
     } 
-    print_title();
+    print_title(snap->col_element);
 
-    printf("|");
-    for (int x = 0; x < BOARD_WIDTH; x++) printf("──");
-    printf("|\n");
+    out_printf(&out, "|");
+    for (int x = 0; x < BOARD_WIDTH; x++) out_printf(&out, "──");
+    out_printf(&out, "|\n");
 
     for (int y = 0; y < BOARD_HEIGHT; y++) {
-    printf("|");
+    out_printf(&out, "|");
     for (int x = 0; x < BOARD_WIDTH; x++) {
         if (disp_board[y][x] == '#') {
-            print_color_block(color[y][x]);
+            print_color_block(snap->block_appearance, snap->color[y][x]);
         } else if (disp_board[y][x] == '@') {
-            print_color_block(piece->color); 
+            print_color_block(snap->block_appearance, piece->color); 
         } else {
-            printf("  "); 
+            out_append(&out, "  ", 2); 
         }
     }
-    printf("|\n");
+    out_printf(&out, "|\n");
 }
 
-    printf("|");
-    for (int x = 0; x < BOARD_WIDTH; x++) printf("──");
-    printf("|\n\n");
-    printf("Next Piece:\n");
-    printf("|");
-    for (int x = 0; x < 4; x++) printf("──");
-    printf("|\n");
+    out_printf(&out, "|");
+    for (int x = 0; x < BOARD_WIDTH; x++) out_printf(&out, "──");
+    out_printf(&out, "|\n\n");
+    out_printf(&out, "Next Piece:\n");
+    out_printf(&out, "|");
+    for (int x = 0; x < 4; x++) out_printf(&out, "──");
+    out_printf(&out, "|\n");
 
     for (int y = 0; y < 4; y++) {
-        printf("|");
+        out_printf(&out, "|");
         for (int x = 0; x < 4; x++) {
             if (next_piece->shape[y][x]) {
-                print_color_block(next_piece->color);
+                print_color_block(snap->block_appearance, next_piece->color);
             } else {
-                printf("  ");
+                out_append(&out, "  ", 2);
             }
         }
-        printf("|");
+        out_printf(&out, "|");
         switch(y) {
-            case 0: printf(" %s", paused ? "Paused" : ""); break;
-            case 1: printf(" Score: %d", score); break;
-            case 2: printf(" Level: %d", level);break;
-            case 3: printf(" Rows Cleared: %d ", rows_cleared);break;
+            case 0: out_printf(&out, " %s", snap->paused ? "Paused" : ""); break;
+            case 1: out_printf(&out, " Score: %d", snap->score); break;
+            case 2: out_printf(&out, " Level: %d", snap->level);break;
+            case 3: out_printf(&out, " Rows Cleared: %d ", snap->rows_cleared);break;
             default: break;
         }
-        printf("\n");
+        out_printf(&out, "\n");
     }
 
-    printf("|");
-    for (int x = 0; x < 4; x++) printf("──");
-    printf("|\n");
-
-    printf("Controls\n WASD/Arrow Keys to move\n W/Up to rotate\n R to reset\n Q to quit\n Space to pause\n E to change block appearance\n F to stop title flash\n");
-    printf("\n");
+    out_printf(&out, "|");
+    for (int x = 0; x < 4; x++) out_printf(&out, "──");
+    out_printf(&out, "|\n");
+
+    out_printf(&out, "Frames dropped: %ld  Output: %.1f KB/s\n\n", out.frames_dropped, out.bytes_per_second / 1024);
+    out_printf(&out, "Controls\n WASD/Arrow Keys to move\n W/Up to rotate\n R to reset\n Q to quit\n Space to pause\n E to change block appearance\n F to stop title flash\n T to show frame stats\n");
+    out_printf(&out, "\n");
+    if (snap->stats_visible) {
+        char line[128];
+        for (int i = 0; i < STATS_OVERLAY_LINES; i++) {
+            stats_overlay_line(&stats, i, line, sizeof(line));
+            out_printf(&out, "%s\n", line);
+        }
+    }
 }
 
 static void process_input(Piece* current_piece) {
@@ -434,11 +481,7 @@ static void process_input(Piece* current_piece) {
         case 's': case 'S': move_piece(current_piece, 0, 1); break;
         case 'd': case 'D': move_piece(current_piece, 1, 0); break;
         case 'a': case 'A': move_piece(current_piece, -1, 0); break;
-        case 'q': case 'Q':
-            cleanup_terminal();
-            printf("\nGame Over\n");
-            exit(0);
-            break;
+        case 'q': case 'Q': quit_requested = true; break;
         case 'r': case 'R':
             memset(board, 0, sizeof(board));
             memset(color, 0, sizeof(color));
@@ -455,41 +498,110 @@ static void process_input(Piece* current_piece) {
             block_appearance = (block_appearance + 1) % BLOCK_TYPES;
             break;
         case 'F': case 'f': title_flash_pause = !title_flash_pause; break;
+        case 'T': case 't': stats_visible = !stats_visible; break;
     }
 }
 
-int main() {
-    srand(time(NULL));
-    setup_terminal();
+// Publishes the current state unless it matches the last one published, so
+// every snapshot the renderer sees is a frame worth drawing. The tick's
+// timings go along with it but do not count as a change.
+static void publish_snapshot(const Piece* current_piece, long input_ns, long update_ns) {
+    static Snapshot published;
+    Snapshot snap;
+    memset(&snap, 0, sizeof(snap));
+    memcpy(snap.board, board, sizeof(board));
+    memcpy(snap.color, color, sizeof(color));
+    snap.piece = *current_piece;
+    snap.next_piece = next_piece;
+    snap.score = score;
+    snap.level = level;
+    snap.rows_cleared = rows_cleared;
+    snap.block_appearance = block_appearance;
+    snap.col_element = col_element;
+    snap.paused = paused;
+    snap.stats_visible = stats_visible;
+
+    snap.info = published.info;
+    if (published.info.sequence > 0 && memcmp(&snap, &published, sizeof(snap)) == 0) return;
+    snap.info.sequence++;
+    snap.info.input_ns = input_ns;
+    snap.info.update_ns = update_ns;
+    published = snap;
+    memcpy(triple_back(&snapshots), &snap, sizeof(snap));
+    triple_publish(&snapshots);
+}
+
+static void* simulation_thread(void* arg) {
+    (void) arg;
     Piece current_piece;
-     
+    struct timespec deadline;
+
     init_piece(&current_piece);
     init_piece(&next_piece);
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
 
-    while (true) {
+    while (atomic_load(&running)) {
+        long long tick_start = stats_now_ns();
         process_input(&current_piece);
+        long long input_done = stats_now_ns();
         if (!paused) {
-            system(CLEAR_CMD);
-            render(&current_piece, &next_piece);
+            update_title_color();
             fall_counter++;
             if (fall_counter >= fall_speed) {
                 move_piece(&current_piece, 0, 1);
                 fall_counter = 0;
             }
-
-            if (is_game_over()) {
-                printf("\nGame Over\n");
-                break;
-            }
-
-            usleep(MICROSECONDS_PER_TICK);
         } else {
             title_flash_pause = false;
-            system(CLEAR_CMD);
-            render(&current_piece, &next_piece);
-            usleep(MICROSECONDS_PER_TICK * 100);
         }
+
+        publish_snapshot(&current_piece, input_done - tick_start, stats_now_ns() - input_done);
+        if (quit_requested || is_game_over()) {
+            atomic_store(&running, false);
+            break;
+        }
+        loop_wait_for_tick(&deadline, MICROSECONDS_PER_TICK);
     }
+    return NULL;
+}
+
+static void draw_snapshot(const void* snapshot) {
+    out_printf(&out, CLEAR_SCREEN);
+    render(snapshot);
+}
+
+static RenderLoop render_loop = {&snapshots, &out, &stats, &running, draw_snapshot};
+
+int main(int argc, char* argv[]) {
+    const char* stats_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats-file") == 0 && i + 1 < argc) stats_path = argv[++i];
+    }
+    if (!stats_open(&stats, stats_path)) {
+        printf("Could not open %s for writing\n", stats_path);
+        return 1;
+    }
+
+    srand(time(NULL));
+    setup_terminal();
+    triple_init(&snapshots, snapshot_slots, sizeof(Snapshot));
+    atomic_init(&running, true);
+    out_init(&out, STDOUT_FILENO);
+
+    pthread_t simulation, renderer;
+    bool simulating = pthread_create(&simulation, NULL, simulation_thread, NULL) == 0;
+    bool rendering = simulating && pthread_create(&renderer, NULL, render_loop_thread, &render_loop) == 0;
+    if (!rendering) atomic_store(&running, false);
+    if (simulating) pthread_join(simulation, NULL);
+    if (rendering) pthread_join(renderer, NULL);
+    out_close(&out);
+    stats_close(&stats);
+
     cleanup_terminal();
+    if (!rendering) {
+        fprintf(stderr, "Could not start the game threads\n");
+        return 1;
+    }
+    printf("\nGame Over\n");
     return 0;
-}
\ No newline at end of file
+}
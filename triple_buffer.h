@@ -0,0 +1,60 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Hands snapshots from one writer thread to one reader thread without either
+// ever waiting. The caller owns three slots of slot_size bytes. The writer
+// fills its back slot and publishes it, swapping it into the middle; the
+// reader swaps the middle out whenever a fresher one is there. A snapshot the
+// reader never got to is simply overwritten by the next, so a slow reader
+// sees fewer frames rather than older ones.
+
+#define TRIPLE_FRESH 4
+
+typedef struct {
+    unsigned char *storage;
+    size_t slot_size;
+    int back;
+    int front;
+    atomic_int middle;
+} TripleBuffer;
+
+static void triple_init(TripleBuffer *tb, void *storage, size_t slot_size) {
+    tb->storage = storage;
+    tb->slot_size = slot_size;
+    tb->back = 0;
+    tb->front = 1;
+    atomic_init(&tb->middle, 2);
+}
+
+static void *triple_slot(TripleBuffer *tb, int index) {
+    return tb->storage + (size_t) index * tb->slot_size;
+}
+
+// The slot the writer may fill. It stays the writer's until published.
+static void *triple_back(TripleBuffer *tb) {
+    return triple_slot(tb, tb->back);
+}
+
+static void triple_publish(TripleBuffer *tb) {
+    int old = atomic_exchange_explicit(&tb->middle, tb->back | TRIPLE_FRESH, memory_order_acq_rel);
+    tb->back = old & ~TRIPLE_FRESH;
+}
+
+// Takes the newest published snapshot if there is one the reader has not
+// seen, and returns the reader's current slot either way. fresh reports which.
+static const void *triple_acquire(TripleBuffer *tb, bool *fresh) {
+    bool changed = false;
+    if (atomic_load_explicit(&tb->middle, memory_order_relaxed) & TRIPLE_FRESH) {
+        int old = atomic_exchange_explicit(&tb->middle, tb->front, memory_order_acq_rel);
+        tb->front = old & ~TRIPLE_FRESH;
+        changed = true;
+    }
+    if (fresh) *fresh = changed;
+    return triple_slot(tb, tb->front);
+}
+
+#endif